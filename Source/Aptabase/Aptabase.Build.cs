@@ -4,8 +4,10 @@ public class Aptabase : ModuleRules
 {
 	public Aptabase(ReadOnlyTargetRules Target) : base(Target)
 	{
+		// The public IAptabaseAnalytics interface derives from IAnalyticsProvider
+		PublicDependencyModuleNames.Add("Analytics");
+
 		PrivateDependencyModuleNames.AddRange(new string[]{
-			"Analytics",
 			"Core", 
 			"CoreUObject",
 			"DeveloperSettings",
@@ -17,6 +19,7 @@ public class Aptabase : ModuleRules
 			"Projects",
 			"Slate",
 			"SlateCore",
+			"TraceLog",
 		});
 
 		if (Target.bBuildEditor)
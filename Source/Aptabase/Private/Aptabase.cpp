@@ -8,6 +8,8 @@
 #endif
 
 #include "AptabaseAnalyticsProvider.h"
+#include "AptabaseSettings.h"
+#include "AptabaseTrace.h"
 
 TSharedPtr<IAnalyticsProvider> FAptabaseModule::CreateAnalyticsProvider(const FAnalyticsProviderConfigurationDelegate& GetConfigValue) const
 {
@@ -16,6 +18,8 @@ TSharedPtr<IAnalyticsProvider> FAptabaseModule::CreateAnalyticsProvider(const FA
 
 void FAptabaseModule::StartupModule()
 {
+	LLM_SCOPE_BYTAG(Aptabase);
+
 	AnalyticsProvider = MakeShared<FAptabaseAnalyticsProvider>();
 
 	if (FSlateApplication::IsInitialized())
@@ -31,6 +35,12 @@ void FAptabaseModule::StartupModule()
 
 void FAptabaseModule::ShutdownModule()
 {
+	// Without Slate (e.g. dedicated servers) the pre-shutdown callback never fires
+	if (AnalyticsProvider.IsValid())
+	{
+		OnApplicationShutdown();
+	}
+
 	if (FSlateApplication::IsInitialized())
 	{
 		FSlateApplication& Application = FSlateApplication::Get();
@@ -47,6 +57,9 @@ void FAptabaseModule::OnApplicationShutdown()
 	if (AnalyticsProvider.IsValid())
 	{
 		AnalyticsProvider->EndSession();
+
+		// Gives the requests of the final flush a chance to complete, the provider and its callbacks are gone right after
+		StaticCastSharedPtr<FAptabaseAnalyticsProvider>(AnalyticsProvider)->Drain(GetDefault<UAptabaseSettings>()->ShutdownDrainTimeout);
 	}
 
 	AnalyticsProvider.Reset();
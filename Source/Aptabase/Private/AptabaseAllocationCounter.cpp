@@ -0,0 +1,79 @@
+#include "AptabaseAllocationCounter.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include <HAL/MemoryBase.h>
+
+namespace
+{
+	// Counter of the current thread, null on threads that aren't counting
+	thread_local int64* CurrentThreadAllocations = nullptr;
+
+	/**
+	 * @brief Forwards everything to the allocator it replaces, counting the allocations of the threads that asked for it
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		FMalloc* InnerMalloc = nullptr;
+
+		// Begin FMalloc Interface
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+		// End FMalloc Interface
+
+	private:
+		static void CountAllocation()
+		{
+			if (CurrentThreadAllocations)
+			{
+				++*CurrentThreadAllocations;
+			}
+		}
+	};
+
+	// Never destroyed, a thread may still be calling into it right after the counter put the previous allocator back
+	FCountingMalloc CountingMalloc;
+} // namespace
+
+FAptabaseAllocationCounter::FAptabaseAllocationCounter()
+{
+	check(GMalloc != &CountingMalloc);
+
+	PreviousMalloc = GMalloc;
+	CountingMalloc.InnerMalloc = PreviousMalloc;
+	CurrentThreadAllocations = &NumAllocations;
+	GMalloc = &CountingMalloc;
+}
+
+FAptabaseAllocationCounter::~FAptabaseAllocationCounter()
+{
+	check(GMalloc == &CountingMalloc);
+
+	GMalloc = PreviousMalloc;
+	CurrentThreadAllocations = nullptr;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <CoreTypes.h>
+#include <Misc/AssertionMacros.h>
+
+#if !UE_BUILD_SHIPPING
+
+class FMalloc;
+
+/**
+ * @brief Counts the heap allocations the calling thread makes while in scope, to see how many copies an event costs
+ * @note Development only. GMalloc goes through a counting proxy while a counter exists, allocations from other threads
+ * pass through it uncounted. Counters can't be nested.
+ */
+class FAptabaseAllocationCounter
+{
+public:
+	FAptabaseAllocationCounter();
+	~FAptabaseAllocationCounter();
+	UE_NONCOPYABLE(FAptabaseAllocationCounter);
+
+	/**
+	 * @brief Allocations and reallocations made so far in the scope
+	 */
+	int64 GetNumAllocations() const { return NumAllocations; }
+
+private:
+	/**
+	 * @brief Allocator in place before the counter, restored when it goes out of scope
+	 */
+	FMalloc* PreviousMalloc = nullptr;
+	/**
+	 * @brief Incremented by the proxy, only from the thread that created the counter
+	 */
+	int64 NumAllocations = 0;
+};
+
+#endif
@@ -1,233 +1,1716 @@
 #include "AptabaseAnalyticsProvider.h"
 
-#include <Dom/JsonValue.h>
-#include <Engine/Engine.h>
-#include <Engine/GameInstance.h>
+#include <Async/Async.h>
 #include <GeneralProjectSettings.h>
-#include <HttpModule.h>
+#include <HAL/PlatformProcess.h>
 #include <Interfaces/IHttpResponse.h>
 #include <Interfaces/IPluginManager.h>
+#include <Internationalization/Internationalization.h>
 #include <Kismet/GameplayStatics.h>
 #include <Kismet/KismetInternationalizationLibrary.h>
-#include <Serialization/JsonSerializer.h>
-#include <TimerManager.h>
+#include <Misc/Compression.h>
+#include <Misc/Crc.h>
+#include <Misc/Paths.h>
+#include <Misc/ScopeExit.h>
+#include <Misc/ScopeLock.h>
+#include <ProfilingDebugging/CsvProfiler.h>
+#include <Templates/UnrealTemplate.h>
 
 #include "AptabaseData.h"
+#include "AptabaseEventSerializer.h"
+#include "AptabaseEventSpool.h"
 #include "AptabaseLog.h"
+#include "AptabaseNameTable.h"
+#include "AptabaseRetryPolicy.h"
 #include "AptabaseSettings.h"
+#include "AptabaseTrace.h"
+#include "AptabaseTransport.h"
+#include "AptabaseWorker.h"
+#include "ExtendedAnalyticsEvent.h"
 #include "ExtendedAnalyticsEventAttribute.h"
 
+CSV_DEFINE_CATEGORY(Aptabase, true);
+
+DECLARE_CYCLE_STAT(TEXT("Record Event"), STAT_AptabaseRecordEvent, STATGROUP_Aptabase);
+DECLARE_CYCLE_STAT(TEXT("Flush Events"), STAT_AptabaseFlushEvents, STATGROUP_Aptabase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued Events"), STAT_AptabaseQueuedEvents, STATGROUP_Aptabase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued Bytes"), STAT_AptabaseQueuedBytes, STATGROUP_Aptabase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Requests In Flight"), STAT_AptabaseRequestsInFlight, STATGROUP_Aptabase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Events Sent"), STAT_AptabaseEventsSent, STATGROUP_Aptabase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Events Dropped"), STAT_AptabaseEventsDropped, STATGROUP_Aptabase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Events Retried"), STAT_AptabaseEventsRetried, STATGROUP_Aptabase);
+
 namespace
 {
-	UGameInstance* GetCurrentGameInstance()
+	// Most events the backend accepts in a single request
+	constexpr int32 MaxEventsPerRequest = 25;
+
+	// How often Drain checks on the requests in flight, in seconds
+	constexpr float DrainPollInterval = 0.01f;
+
+	bool IsInReleaseMode()
+	{
+		// TODO: This should be something more extensible/customizable.
+		//  Developers should be able to decide on the fly if they are running Debug/Release
+
+		return UE_BUILD_SHIPPING;
+	}
+
+	bool CompressGzip(const TArray<uint8>& Uncompressed, TArray<uint8>& OutCompressed)
+	{
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Gzip, Uncompressed.Num());
+		OutCompressed.SetNumUninitialized(CompressedSize, EAllowShrinking::No);
+
+		if (!FCompression::CompressMemory(NAME_Gzip, OutCompressed.GetData(), CompressedSize, Uncompressed.GetData(), Uncompressed.Num()))
+		{
+			return false;
+		}
+
+		OutCompressed.SetNum(CompressedSize, EAllowShrinking::No);
+		return true;
+	}
+
+	FString MakeSessionId()
+	{
+		const int64 EpochInSeconds = FDateTime::UtcNow().ToUnixTimestamp();
+		const int Random = FMath::RandRange(0, 99999999);
+		const FString RandomString = FString::Printf(TEXT("%08d"), Random);
+		return FString::Printf(TEXT("%lld%s"), EpochInSeconds, *RandomString);
+	}
+
+	void ConvertAttributeValue(const FAnalyticsEventAttribute& Attribute, FAptabaseEventAttribute& OutAttribute)
 	{
-		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		const FString& Value = Attribute.GetValue();
+
+		// Numbers and booleans are stored as JSON fragments, they keep their type instead of being sent as strings
+		if (Attribute.IsJsonFragment())
 		{
-			if (Context.WorldType == EWorldType::PIE || Context.WorldType == EWorldType::Game)
+			if (Value == TEXT("true") || Value == TEXT("false"))
 			{
-				if (UGameInstance* GameInstance = Context.OwningGameInstance)
-				{
-					return GameInstance;
-				}
+				OutAttribute.Value.Set<bool>(Value == TEXT("true"));
+				return;
+			}
+
+			TCHAR* End = nullptr;
+			const int64 IntegerValue = FCString::Strtoi64(*Value, &End, 10);
+			if (End != *Value && *End == TCHAR('\0'))
+			{
+				OutAttribute.Value.Set<int64>(IntegerValue);
+				return;
+			}
+
+			if (FCString::IsNumeric(*Value))
+			{
+				OutAttribute.Value.Set<double>(FCString::Atod(*Value));
+				return;
 			}
 		}
 
-		return nullptr;
+		OutAttribute.Value.Set<FString>(Value);
 	}
 
-	bool IsInReleaseMode()
+	void RestoreRequestBody(const IAptabaseTransportRequest& Request, FAptabaseEventBatch& Batch)
 	{
-		// TODO: This should be something more extensible/customizable.
-		//  Developers should be able to decide on the fly if they are running Debug/Release
-
-		return UE_BUILD_SHIPPING;
+		// The request took the body over when it was sent
+		TArray<uint8>& SentBody = Request.IsCompressed() ? Batch.CompressedBody : Batch.Body;
+		SentBody = Request.GetBody();
 	}
 } // namespace
 
-void FAptabaseAnalyticsProvider::RecordExtendedEvent(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes)
+FAptabaseAnalyticsProvider::FAptabaseAnalyticsProvider()
+	: FAptabaseAnalyticsProvider(nullptr)
 {
-	RecordEventInternal(EventName, Attributes);
 }
 
-bool FAptabaseAnalyticsProvider::StartSession(const TArray<FAnalyticsEventAttribute>& Attributes)
+FAptabaseAnalyticsProvider::FAptabaseAnalyticsProvider(TUniquePtr<IAptabaseTransport>&& InTransport)
+	: SampleWeightKey(FAptabaseNameTable::Get().Intern(TEXT("sample_weight")))
 {
-	const UGameInstance* GameInstance = GetCurrentGameInstance();
-	if (!ensure(GameInstance))
-	{
-		UE_LOG(LogAptabase, Warning, TEXT("Cannot start session: Invalid game instance."));
-		return false;
-	}
+	LLM_SCOPE_BYTAG(Aptabase);
 
-	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
-	const float SendInterval = IsInReleaseMode() ? Settings->SendInterval : Settings->DebugSendInterval;
-	GameInstance->GetTimerManager().SetTimer(BatchEventTimerHandle, FTimerDelegate::CreateRaw(this, &FAptabaseAnalyticsProvider::FlushEvents), SendInterval, true);
+	UAptabaseSettings* Settings = GetMutableDefault<UAptabaseSettings>();
+	Sampler.SetRules(Settings->SamplingRules);
+	SamplingRulesChangedHandle = Settings->OnSamplingRulesChanged.AddRaw(this, &FAptabaseAnalyticsProvider::OnSamplingRulesChanged);
 
-	const int64 EpochInSeconds = FDateTime::UtcNow().ToUnixTimestamp();
-	const int Random = FMath::RandRange(0, 99999999);
-	const FString RandomString = FString::Printf(TEXT("%08d"), Random);
-	SessionId = FString::Printf(TEXT("%lld%s"), EpochInSeconds, *RandomString);
+	// Created from the game thread, the HTTP module must be loaded before the worker creates its first request
+	Transport = InTransport.IsValid() ? MoveTemp(InTransport) : IAptabaseTransport::Create(Settings->bUseBackgroundWorker);
 
-	bHasActiveSession = true;
-	return true;
+	if (Settings->bUseBackgroundWorker)
+	{
+		Worker = MakeUnique<FAptabaseWorker>();
+	}
 }
 
-void FAptabaseAnalyticsProvider::EndSession()
+FAptabaseAnalyticsProvider::~FAptabaseAnalyticsProvider()
 {
-	if (BatchEventTimerHandle.IsValid())
+	// Joins the worker first, its remaining tasks can't reach the provider anymore and the tickers below are still valid
+	Worker.Reset();
+
+	if (CultureChangedHandle.IsValid() && FInternationalization::IsAvailable())
 	{
-		if (const UGameInstance* GameInstance = GetCurrentGameInstance())
-		{
-			GameInstance->GetTimerManager().ClearTimer(BatchEventTimerHandle);
-		}
+		FInternationalization::Get().OnCultureChanged().Remove(CultureChangedHandle);
 	}
 
-	// Send any leftover events if any before closing the active session
-	FlushEvents();
+	if (UObjectInitialized())
+	{
+		GetMutableDefault<UAptabaseSettings>()->OnSamplingRulesChanged.Remove(SamplingRulesChangedHandle);
+	}
 
-	bHasActiveSession = false;
+	FTSTicker::RemoveTicker(RetryTickerHandle);
+	FTSTicker::RemoveTicker(FlushTickerHandle);
+	FTSTicker::RemoveTicker(PersistTickerHandle);
+
+	delete Sessions.load();
 }
 
-FString FAptabaseAnalyticsProvider::GetSessionID() const
+void FAptabaseAnalyticsProvider::OnSamplingRulesChanged()
 {
-	return SessionId;
+	UE_LOG(LogAptabase, Log, TEXT("Applying updated sampling rules."));
+	Sampler.SetRules(GetDefault<UAptabaseSettings>()->SamplingRules);
 }
 
-bool FAptabaseAnalyticsProvider::SetSessionID(const FString& InSessionID)
+void FAptabaseAnalyticsProvider::SetSamplingRules(TConstArrayView<FAptabaseSamplingRule> Rules)
 {
-	UE_LOG(LogAptabase, Log, TEXT("Aptabase automatically generates and manage sessions. Discarding session id set request."));
-	return false;
+	Sampler.SetRules(Rules);
 }
 
-void FAptabaseAnalyticsProvider::FlushEvents()
+void FAptabaseAnalyticsProvider::RecordExtendedEvent(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority)
 {
-	UE_LOG(LogAptabase, Verbose, TEXT("Flushing %s batched events."), *LexToString(BatchedEvents.Num()));
+	RecordSessionExtendedEvent(FAptabaseSessionHandle(), EventName, Attributes, Priority);
+}
 
-	TArrayView<FAptabaseEventPayload> EventsToProcess = BatchedEvents;
+void FAptabaseAnalyticsProvider::RecordExtendedEvent(const FString& EventName, TArray<FExtendedAnalyticsEventAttribute>&& Attributes, EAptabaseEventPriority Priority)
+{
+	RecordSessionExtendedEvent(FAptabaseSessionHandle(), EventName, MoveTemp(Attributes), Priority);
+}
 
-	while (!EventsToProcess.IsEmpty())
+void FAptabaseAnalyticsProvider::RecordExtendedEvents(TConstArrayView<FExtendedAnalyticsEvent> Events)
+{
+	if (!bHasActiveSession)
 	{
-		constexpr int32 NumEventsPerRequest = 25;
+		UE_LOG(LogAptabase, Warning, TEXT("No session is currently active. Discarding %d events."), Events.Num());
+		return;
+	}
 
-		TArray<FAptabaseEventPayload> CurrentBatch;
-		CurrentBatch.Append(EventsToProcess.Left(NumEventsPerRequest));
+	LLM_SCOPE_BYTAG(Aptabase);
+	SCOPE_CYCLE_COUNTER(STAT_AptabaseRecordEvent);
+	FAptabaseScopedCycleCounter RecordCycleCounter(Counters.RecordCycles);
 
-		EventsToProcess.RightChopInline(NumEventsPerRequest);
-		SendEventsNow(CurrentBatch);
+	FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+	for (const FExtendedAnalyticsEvent& Event : Events)
+	{
+		RecordEventInternal(FAptabaseSessionHandle(), Event.EventName, Event.Priority, [&NameTable, &Event](FAptabaseEventAttributeArray& OutAttributes)
+		{
+			OutAttributes.Reserve(Event.Attributes.Num());
+			for (const FExtendedAnalyticsEventAttribute& Attribute : Event.Attributes)
+			{
+				OutAttributes.Add({NameTable.Intern(Attribute.Key), Attribute.Value});
+			}
+		});
 	}
+}
+
+void FAptabaseAnalyticsProvider::RecordSessionExtendedEvent(FAptabaseSessionHandle Session, const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority)
+{
+	LLM_SCOPE_BYTAG(Aptabase);
+	SCOPE_CYCLE_COUNTER(STAT_AptabaseRecordEvent);
+	FAptabaseScopedCycleCounter RecordCycleCounter(Counters.RecordCycles);
 
-	BatchedEvents.Empty();
+	FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+	RecordEventInternal(Session, EventName, Priority, [&NameTable, &Attributes](FAptabaseEventAttributeArray& OutAttributes)
+	{
+		OutAttributes.Reserve(Attributes.Num());
+		for (const FExtendedAnalyticsEventAttribute& Attribute : Attributes)
+		{
+			OutAttributes.Add({NameTable.Intern(Attribute.Key), Attribute.Value});
+		}
+	});
 }
 
-void FAptabaseAnalyticsProvider::SetUserID(const FString& InUserID)
+void FAptabaseAnalyticsProvider::RecordSessionExtendedEvent(FAptabaseSessionHandle Session, const FString& EventName, TArray<FExtendedAnalyticsEventAttribute>&& Attributes, EAptabaseEventPriority Priority)
 {
-	UE_LOG(LogAptabase, Log, TEXT("Aptabase is a privacy-first solution and will NOT send the UserId to the backend. Discarding user id set request."));
+	LLM_SCOPE_BYTAG(Aptabase);
+	SCOPE_CYCLE_COUNTER(STAT_AptabaseRecordEvent);
+	FAptabaseScopedCycleCounter RecordCycleCounter(Counters.RecordCycles);
 
-	UserId = InUserID;
+	FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+	RecordEventInternal(Session, EventName, Priority, [&NameTable, &Attributes](FAptabaseEventAttributeArray& OutAttributes)
+	{
+		OutAttributes.Reserve(Attributes.Num());
+		for (FExtendedAnalyticsEventAttribute& Attribute : Attributes)
+		{
+			OutAttributes.Add({NameTable.Intern(Attribute.Key), MoveTemp(Attribute.Value)});
+		}
+	});
+
+	Attributes.Empty();
 }
 
-FString FAptabaseAnalyticsProvider::GetUserID() const
+bool FAptabaseAnalyticsProvider::StartSession(const TArray<FAnalyticsEventAttribute>& Attributes)
 {
-	return UserId;
+	LLM_SCOPE_BYTAG(Aptabase);
+
+	SessionId = MakeSessionId();
+	DefaultSessionSeed = FCrc::StrCrc32(*SessionId);
+
+	// The snapshot reads engine state that is only safe to access from the game thread
+	const TSharedRef<const FAptabaseSessionSnapshot> Snapshot = MakeSessionSnapshot(SessionId);
+	if (IsInPipelineThread())
+	{
+		StartPipeline(Snapshot);
+	}
+	else
+	{
+		RunOnPipelineThread([Snapshot](FAptabaseAnalyticsProvider& This)
+		{
+			This.StartPipeline(Snapshot);
+		});
+	}
+
+	if (!CultureChangedHandle.IsValid())
+	{
+		CultureChangedHandle = FInternationalization::Get().OnCultureChanged().AddRaw(this, &FAptabaseAnalyticsProvider::RefreshSystemProperties);
+	}
+
+	bHasActiveSession = true;
+
+	return true;
 }
 
-void FAptabaseAnalyticsProvider::RecordEvent(const FString& EventName, const TArray<FAnalyticsEventAttribute>& Attributes)
+void FAptabaseAnalyticsProvider::StartPipeline(const TSharedRef<const FAptabaseSessionSnapshot>& Snapshot)
+{
+	check(IsInPipelineThread());
+
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+
+	SessionSnapshot = Snapshot;
+	Aggregator.Configure(Settings->AggregatedEvents);
+
+	if (Settings->bPersistEvents && !Spool.IsValid())
+	{
+		// Anything a previous run couldn't deliver (crash, force-quit, unfinished requests on shutdown) is sent first
+		Spool = MakeUnique<FAptabaseEventSpool>(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Aptabase"), TEXT("EventSpool.bin")));
+		for (const TSharedRef<FAptabaseEventBatch>& Batch : Spool->Open())
+		{
+			if (FAptabaseRetryPolicy::IsExpired(*Batch))
+			{
+				UE_LOG(LogAptabase, Log, TEXT("Discarding %d events from a previous run, they are older than MaxEventAge."), Batch->NumEvents);
+				Counters.EventsDiscarded += Batch->NumEvents;
+				Spool->Acknowledge(*Batch);
+				continue;
+			}
+
+			EnqueueBatch(Batch);
+		}
+
+		DispatchPendingBatches();
+	}
+}
+
+void FAptabaseAnalyticsProvider::EndSession()
 {
-	TArray<FExtendedAnalyticsEventAttribute> ExtendedAttributes;
-	for (const FAnalyticsEventAttribute& Attribute : Attributes)
+	LLM_SCOPE_BYTAG(Aptabase);
+
+	// Stop accepting new events first so nothing recorded concurrently slips in after the final drain
+	bHasActiveSession = false;
+
+	UpdateSessions([](FSessionMap& SessionMap)
+	{
+		SessionMap.Reset();
+	});
+
+	// Send any leftover events if any before closing the active session
+	if (Worker.IsValid())
 	{
-		FExtendedAnalyticsEventAttribute& NewAttribute = ExtendedAttributes.Emplace_GetRef();
-		NewAttribute.Key = Attribute.GetName();
-		NewAttribute.Value.Set<FString>(Attribute.GetValue());
+		// Waits for the worker so the summaries and batches of this session are encoded before it ends
+		Worker->EnqueueAndWait([this]()
+		{
+			FlushEvents();
+		});
+	}
+	else
+	{
+		FlushEvents();
 	}
 
-	RecordEventInternal(EventName, ExtendedAttributes);
+	if (CultureChangedHandle.IsValid())
+	{
+		FInternationalization::Get().OnCultureChanged().Remove(CultureChangedHandle);
+		CultureChangedHandle.Reset();
+	}
 }
 
-void FAptabaseAnalyticsProvider::RecordEventInternal(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes)
+void FAptabaseAnalyticsProvider::RefreshSystemProperties()
 {
 	if (!bHasActiveSession)
 	{
-		UE_LOG(LogAptabase, Warning, TEXT("No session is currently active. Discarding event."));
 		return;
 	}
 
-	const TSharedPtr<IPlugin> AptabasePlugin = IPluginManager::Get().FindPlugin("Aptabase");
+	UE_LOG(LogAptabase, Verbose, TEXT("Refreshing system properties for session %s."), *SessionId);
 
-	FAptabaseEventPayload EventPayload;
-	EventPayload.EventName = EventName;
-	EventPayload.SessionId = SessionId;
-	EventPayload.EventAttributes = Attributes;
-	EventPayload.TimeStamp = FDateTime::UtcNow().ToIso8601();
-	EventPayload.SystemProps.Locale = UKismetInternationalizationLibrary::GetCurrentLocale();
-	EventPayload.SystemProps.AppVersion = GetDefault<UGeneralProjectSettings>()->ProjectVersion;
-	EventPayload.SystemProps.SdkVersion = FString::Printf(TEXT("aptabase-unreal@%s"), *AptabasePlugin->GetDescriptor().VersionName);
-	EventPayload.SystemProps.OsName = UGameplayStatics::GetPlatformName();
-	EventPayload.SystemProps.OsVersion = FPlatformMisc::GetOSVersion();
-	EventPayload.SystemProps.IsDebug = !IsInReleaseMode();
+	// Events of the other sessions hold on to the snapshot they were recorded with, they can be swapped right away
+	UpdateSessions([](FSessionMap& SessionMap)
+	{
+		for (TPair<uint32, TSharedRef<const FAptabaseSessionSnapshot>>& Session : SessionMap)
+		{
+			Session.Value = MakeSessionSnapshot(Session.Value->SessionId, Session.Value->Properties);
+		}
+	});
 
-	UE_LOG(LogAptabase, Verbose, TEXT("Batching event (%s) for next flush."), *EventName);
-	BatchedEvents.Emplace(EventPayload);
+	// Events recorded so far must keep the snapshot that was current when they were recorded, so the swap happens in order with the drains
+	const TSharedRef<const FAptabaseSessionSnapshot> Snapshot = MakeSessionSnapshot(SessionId);
+	if (IsInPipelineThread())
+	{
+		DrainIncomingEvents();
+		SessionSnapshot = Snapshot;
+		return;
+	}
+
+	RunOnPipelineThread([Snapshot](FAptabaseAnalyticsProvider& This)
+	{
+		This.DrainIncomingEvents();
+		This.SessionSnapshot = Snapshot;
+	});
+}
+
+FString FAptabaseAnalyticsProvider::GetSessionID() const
+{
+	return SessionId;
 }
 
-void FAptabaseAnalyticsProvider::SendEventsNow(const TArray<FAptabaseEventPayload>& EventPayloads)
+FAptabaseSessionHandle FAptabaseAnalyticsProvider::CreateSession(const FAptabaseSessionProperties& Properties)
 {
-	TArray<TSharedPtr<FJsonValue>> Events;
+	if (!bHasActiveSession)
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Sessions can only be created while the provider's session is active."));
+		return FAptabaseSessionHandle();
+	}
+
+	const TSharedRef<const FAptabaseSessionSnapshot> Snapshot = MakeSessionSnapshot(MakeSessionId(), Properties);
 
-	UE_LOG(LogAptabase, VeryVerbose, TEXT("Sending batch containing:"));
-	for (const FAptabaseEventPayload& EventPayload : EventPayloads)
+	FAptabaseSessionHandle Session;
+	UpdateSessions([this, &Session, &Snapshot](FSessionMap& SessionMap)
 	{
-		UE_LOG(LogAptabase, VeryVerbose, TEXT("Event: %s"), *EventPayload.EventName);
-		const TSharedPtr<FJsonObject>& JsonPayload = EventPayload.ToJsonObject();
+		Session.Id = NextSessionHandleId++;
+		SessionMap.Add(Session.Id, Snapshot);
+	});
+
+	UE_LOG(LogAptabase, Verbose, TEXT("Created session %s (handle %u)."), *Snapshot->SessionId, Session.Id);
+	return Session;
+}
 
-		Events.Add(MakeShared<FJsonValueObject>(JsonPayload));
+void FAptabaseAnalyticsProvider::EndSession(FAptabaseSessionHandle Session)
+{
+	if (Session.IsDefault())
+	{
+		EndSession();
+		return;
 	}
 
-	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+	UpdateSessions([Session](FSessionMap& SessionMap)
+	{
+		SessionMap.Remove(Session.Id);
+	});
+}
+
+FString FAptabaseAnalyticsProvider::GetSessionID(FAptabaseSessionHandle Session) const
+{
+	if (Session.IsDefault())
+	{
+		return SessionId;
+	}
+
+	const TSharedPtr<const FAptabaseSessionSnapshot> Snapshot = FindSession(Session);
+	return Snapshot.IsValid() ? Snapshot->SessionId : FString();
+}
 
-	const FString RequestUrl = FString::Printf(TEXT("%s/api/v0/events"), *Settings->GetApiUrl());
+TSharedPtr<const FAptabaseSessionSnapshot> FAptabaseAnalyticsProvider::FindSession(FAptabaseSessionHandle Session) const
+{
+	const FAptabaseReadEpochs::FReadScope ReadScope(SessionsReadEpochs);
+
+	const FSessionMap* SessionMap = Sessions.load();
+	const TSharedRef<const FAptabaseSessionSnapshot>* Snapshot = SessionMap ? SessionMap->Find(Session.Id) : nullptr;
+	return Snapshot ? TSharedPtr<const FAptabaseSessionSnapshot>(*Snapshot) : nullptr;
+}
+
+void FAptabaseAnalyticsProvider::UpdateSessions(TFunctionRef<void(FSessionMap&)> Update)
+{
+	FScopeLock Lock(&SessionsLock);
+
+	const FSessionMap* PreviousSessionMap = Sessions.load();
+	TUniquePtr<FSessionMap> SessionMap = PreviousSessionMap ? MakeUnique<FSessionMap>(*PreviousSessionMap) : MakeUnique<FSessionMap>();
+	Update(*SessionMap);
 
-	FString RequestJsonPayload;
+	Sessions = SessionMap->IsEmpty() ? nullptr : SessionMap.Release();
 
-	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&RequestJsonPayload, 0);
-	FJsonSerializer::Serialize(Events, JsonWriter);
+	// Threads recording events may still be looking at the previous table
+	SessionsReadEpochs.WaitForReaders();
+	delete PreviousSessionMap;
+}
 
-	const FHttpRequestRef HttpRequest = FHttpModule::Get().CreateRequest();
-	HttpRequest->SetVerb("POST");
-	HttpRequest->SetContentAsString(RequestJsonPayload);
-	HttpRequest->SetHeader(TEXT("App-Key"), Settings->AppKey);
-	HttpRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
-	HttpRequest->SetURL(RequestUrl);
-	HttpRequest->OnProcessRequestComplete().BindRaw(this, &FAptabaseAnalyticsProvider::OnEventsRecoded, EventPayloads);
-	HttpRequest->ProcessRequest();
+bool FAptabaseAnalyticsProvider::SetSessionID(const FString& InSessionID)
+{
+	UE_LOG(LogAptabase, Log, TEXT("Aptabase automatically generates and manage sessions. Discarding session id set request."));
+	return false;
 }
 
-void FAptabaseAnalyticsProvider::OnEventsRecoded(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TArray<FAptabaseEventPayload> OriginalEvents)
+void FAptabaseAnalyticsProvider::FlushEvents()
 {
-	if (!bWasSuccessful)
+	if (!IsInPipelineThread())
 	{
-		UE_LOG(LogAptabase, Error, TEXT("Request to record the event was unsuccessful."));
+		// Batching and sending is owned by the pipeline thread; producers on other threads only ever touch the ingest queue
+		RunOnPipelineThread([](FAptabaseAnalyticsProvider& This)
+		{
+			This.FlushEvents();
+		});
 		return;
 	}
 
-	const auto ResponseCode = Response->GetResponseCode();
-	if (!EHttpResponseCodes::IsOk(ResponseCode))
+	LLM_SCOPE_BYTAG(Aptabase);
+	APTABASE_TRACE_SCOPE(FAptabaseAnalyticsProvider::FlushEvents);
+	SCOPE_CYCLE_COUNTER(STAT_AptabaseFlushEvents);
+	FAptabaseScopedCycleCounter FlushCycleCounter(Counters.FlushCycles);
+	ON_SCOPE_EXIT
 	{
-		UE_LOG(LogAptabase, Error, TEXT("Request to record the event received unexpected code: %s"), *LexToString(Response->GetResponseCode()));
+		const uint64 SliceCycles = FlushCycleCounter.GetElapsedCycles();
+		Counters.LastFlushCycles = SliceCycles;
+		Counters.MaxFlushCycles = FMath::Max<uint64>(Counters.MaxFlushCycles, SliceCycles);
+		++Counters.FlushSlices;
+		PublishStats();
+	};
 
-		if (ResponseCode >= 400 && ResponseCode < 500)
+	// The worker doesn't hold up any frame, and the last flush of a session must be encoded before it ends
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+	const bool bIsTimeSliced = Settings->FlushTimeBudgetMs > 0.0f && !Worker.IsValid() && bHasActiveSession;
+	const uint64 EndCycles = bIsTimeSliced
+		? FPlatformTime::Cycles64() + static_cast<uint64>(Settings->FlushTimeBudgetMs / 1000.0 / FPlatformTime::GetSecondsPerCycle64())
+		: TNumericLimits<uint64>::Max();
+
+	FTSTicker::RemoveTicker(FlushTickerHandle);
+	FlushTickerHandle.Reset();
+	NextFlushTime = TNumericLimits<double>::Max();
+
+	// Reset before draining: an event counted after this point is either drained now or arms the next flush, never lost
+	NumUnflushedEvents = 0;
+	DrainIncomingEvents();
+
+	// Critical events are encoded first so their batches are queued ahead of this flush's other batches
+	if (!CriticalEvents.IsEmpty())
+	{
+		const FAptabaseEventBuffer CriticalEventsToProcess = MoveTemp(CriticalEvents);
+		CriticalEvents.Reset();
+		ReleaseQueuedEvents(CriticalEventsToProcess.Num(), CriticalEventsToProcess.GetAllocatedSize(0, CriticalEventsToProcess.Num()));
+
+		SendEventsNow(CriticalEventsToProcess, 0, TNumericLimits<uint64>::Max(), true);
+	}
+
+	// A flush that ran out of time carries on first, the events drained since then wait for the next one unless this one is unbounded
+	if (!FlushingEvents.IsEmpty() && !bIsTimeSliced)
+	{
+		SendEventsNow(FlushingEvents, NextFlushIndex, EndCycles);
+		FlushingEvents.Reset();
+		NextFlushIndex = 0;
+	}
+
+	if (FlushingEvents.IsEmpty())
+	{
+		BeginFlush();
+	}
+
+	NextFlushIndex = SendEventsNow(FlushingEvents, NextFlushIndex, EndCycles);
+	if (NextFlushIndex < FlushingEvents.Num())
+	{
+		// The core ticker picks tickers added while it ticks up on the next frame
+		UE_LOG(LogAptabase, VeryVerbose, TEXT("Flush time budget exceeded, %d events left for the next frame."), FlushingEvents.Num() - NextFlushIndex);
+		ScheduleFlush(0.0);
+	}
+	else
+	{
+		FlushingEvents.Reset();
+		NextFlushIndex = 0;
+	}
+
+	if (NumUnflushedEvents > 0 || !BatchedEvents.IsEmpty())
+	{
+		ScheduleFlush(GetSendInterval());
+	}
+
+	if (!Aggregator.IsEmpty())
+	{
+		ScheduleFlush(FMath::Max(0.0, Aggregator.GetNextWindowEnd() - FPlatformTime::Seconds()));
+	}
+}
+
+void FAptabaseAnalyticsProvider::BeginFlush()
+{
+	check(IsInPipelineThread());
+
+	// Summary events never entered the queue budget, only the events recorded as-is are released below
+	const int32 NumQueuedEvents = BatchedEvents.Num();
+	FAptabaseSpoolRefs AggregatedSpoolRefs;
+	if (bHasActiveSession)
+	{
+		Aggregator.EmitCompletedWindows(FPlatformTime::Seconds(), BatchedEvents, AggregatedSpoolRefs);
+	}
+	else
+	{
+		Aggregator.EmitAll(BatchedEvents, AggregatedSpoolRefs);
+	}
+
+	// The summaries are on disk before the occurrences they replace are released
+	if (Spool.IsValid() && BatchedEvents.Num() > NumQueuedEvents)
+	{
+		for (int32 Index = NumQueuedEvents; Index < BatchedEvents.Num(); ++Index)
 		{
-			UE_LOG(LogAptabase, Error, TEXT("Data was sent in the wrong format. Event will be skipped."))
+			BatchedEvents.SetSpoolId(Index, BeginJournalEvent(BatchedEvents.GetTimeStamp(Index)));
+			JournalSerializer.WriteEvent(BatchedEvents, Index);
+			EndJournalEvent();
 		}
-		else if (ResponseCode >= 500)
+
+		WriteJournalRecord();
+		Spool->Release(AggregatedSpoolRefs);
+	}
+
+	UE_LOG(LogAptabase, Verbose, TEXT("Flushing %s batched events."), *LexToString(BatchedEvents.Num()));
+	AptabaseTrace::OutputFlush(BatchedEvents.Num());
+
+	// Take ownership of the whole buffer so events recorded while the flush is sliced start from an empty array
+	FlushingEvents = MoveTemp(BatchedEvents);
+	BatchedEvents.Reset();
+	NextFlushIndex = 0;
+	ReleaseQueuedEvents(NumQueuedEvents, FlushingEvents.GetAllocatedSize(0, NumQueuedEvents));
+}
+
+void FAptabaseAnalyticsProvider::ScheduleFlush(double Delay)
+{
+	if (!IsInPipelineThread())
+	{
+		RunOnPipelineThread([Delay](FAptabaseAnalyticsProvider& This)
 		{
-			UE_LOG(LogAptabase, Error, TEXT("Server-side issue. Event will be re-queued."))
-			BatchedEvents.Append(OriginalEvents);
-		}
+			This.ScheduleFlush(Delay);
+		});
+		return;
+	}
 
+	// Only ever bring the flush forward, a later request must not delay events that are already waiting
+	const double FlushTime = FPlatformTime::Seconds() + Delay;
+	if (FlushTickerHandle.IsValid() && NextFlushTime <= FlushTime)
+	{
 		return;
 	}
 
-	UE_LOG(LogAptabase, VeryVerbose, TEXT("Event recorded successfully."));
+	FTSTicker::RemoveTicker(FlushTickerHandle);
+	NextFlushTime = FlushTime;
+	FlushTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FAptabaseAnalyticsProvider::OnFlushTick), Delay);
+}
+
+bool FAptabaseAnalyticsProvider::OnFlushTick(float DeltaTime)
+{
+	// The core ticker runs on the game thread, FlushEvents hands over to the worker if there is one
+	FlushEvents();
+
+	// One-shot, the next recorded event arms a new ticker so an idle queue never wakes up
+	return false;
+}
+
+double FAptabaseAnalyticsProvider::GetSendInterval()
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+	return IsInReleaseMode() ? Settings->SendInterval : Settings->DebugSendInterval;
+}
+
+void FAptabaseAnalyticsProvider::DrainIncomingEvents()
+{
+	check(IsInPipelineThread());
+
+	const double Now = FPlatformTime::Seconds();
+
+	// Reset before draining: an event counted after this point is either drained now or arms the next persist tick
+	NumUnpersistedEvents = 0;
+
+	FAptabaseEventPayload EventPayload;
+	while (IncomingEvents.Dequeue(EventPayload))
+	{
+		if (!EventPayload.Session.IsValid())
+		{
+			EventPayload.Session = SessionSnapshot;
+		}
+
+		// Journaled whichever way the event goes, it stays in the spool until the batch or summary carrying it is delivered
+		if (Spool.IsValid())
+		{
+			EventPayload.SpoolId = BeginJournalEvent(EventPayload.TimeStamp);
+			JournalSerializer.WriteEvent(EventPayload);
+			EndJournalEvent();
+		}
+
+		// Aggregated events only live on as part of their group's summary, which is small and outside of the budget
+		if (Aggregator.Add(EventPayload, Now))
+		{
+			ReleaseQueuedEvents(1, EventPayload.GetAllocatedSize());
+			continue;
+		}
+
+		if (EventPayload.Priority == EAptabaseEventPriority::Critical)
+		{
+			CriticalEvents.Add(MoveTemp(EventPayload));
+			continue;
+		}
+
+		BatchedEvents.Add(MoveTemp(EventPayload));
+	}
+
+	if (Spool.IsValid())
+	{
+		WriteJournalRecord();
+	}
+}
+
+void FAptabaseAnalyticsProvider::SchedulePersist()
+{
+	if (!IsInPipelineThread())
+	{
+		RunOnPipelineThread([](FAptabaseAnalyticsProvider& This)
+		{
+			This.SchedulePersist();
+		});
+		return;
+	}
+
+	if (PersistTickerHandle.IsValid())
+	{
+		return;
+	}
+
+	const float PersistInterval = GetDefault<UAptabaseSettings>()->PersistInterval;
+	PersistTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FAptabaseAnalyticsProvider::OnPersistTick), PersistInterval);
+}
+
+bool FAptabaseAnalyticsProvider::OnPersistTick(float DeltaTime)
+{
+	if (IsInPipelineThread())
+	{
+		PersistTickerHandle.Reset();
+		DrainIncomingEvents();
+	}
+	else
+	{
+		RunOnPipelineThread([](FAptabaseAnalyticsProvider& This)
+		{
+			This.PersistTickerHandle.Reset();
+			This.DrainIncomingEvents();
+		});
+	}
+
+	// One-shot, the next recorded event arms a new ticker
+	return false;
+}
+
+uint64 FAptabaseAnalyticsProvider::BeginJournalEvent(const FDateTime& TimeStamp)
+{
+	if (JournalRecord.SpoolId == 0)
+	{
+		JournalRecord.SpoolId = Spool->ReserveId();
+		JournalRecord.OldestEventTime = TimeStamp;
+		JournalSerializer.BeginBatch();
+	}
+
+	JournalRecord.OldestEventTime = FMath::Min(JournalRecord.OldestEventTime, TimeStamp);
+	return JournalRecord.SpoolId;
+}
+
+void FAptabaseAnalyticsProvider::EndJournalEvent()
+{
+	if (JournalSerializer.GetNumEvents() >= MaxEventsPerRequest || JournalSerializer.GetNumBytes() >= GetDefault<UAptabaseSettings>()->TargetBatchBytes)
+	{
+		WriteJournalRecord();
+	}
+}
+
+void FAptabaseAnalyticsProvider::WriteJournalRecord()
+{
+	if (JournalRecord.SpoolId == 0)
+	{
+		return;
+	}
+
+	// Journal records are encoded like batches, a record left over by a crash is replayed as a request of its own
+	JournalRecord.NumEvents = JournalSerializer.GetNumEvents();
+	JournalRecord.Body = JournalSerializer.EndBatch();
+	Spool->Append(JournalRecord);
+
+	JournalRecord.SpoolId = 0;
+	JournalRecord.Body.Reset();
+}
+
+int64 FAptabaseAnalyticsProvider::GetNumDroppedEvents() const
+{
+	return NumDroppedEvents;
+}
+
+FAptabaseStats FAptabaseAnalyticsProvider::GetStats() const
+{
+	FAptabaseStats Stats;
+	Stats.QueuedEvents = QueuedEvents;
+	Stats.QueuedBytes = QueuedBytes;
+	Stats.EventsRecorded = Counters.EventsRecorded;
+	Stats.EventsSent = Counters.EventsSent;
+	Stats.EventsDropped = NumDroppedEvents;
+	Stats.EventsDiscarded = Counters.EventsDiscarded;
+	Stats.EventsRetried = Counters.EventsRetried;
+	Stats.EventsSampledOut = Counters.EventsSampledOut;
+	Stats.EventsRateLimited = Counters.EventsRateLimited;
+	Stats.BytesUploaded = Counters.BytesUploaded;
+	Stats.BytesBeforeCompression = Counters.BytesBeforeCompression;
+	Stats.RequestsInFlight = NumRequestsInFlight;
+	Stats.RecordTimeMs = FPlatformTime::ToMilliseconds64(Counters.RecordCycles);
+	Stats.FlushTimeMs = FPlatformTime::ToMilliseconds64(Counters.FlushCycles);
+	Stats.LastFlushTimeMs = FPlatformTime::ToMilliseconds64(Counters.LastFlushCycles);
+	Stats.MaxFlushTimeMs = FPlatformTime::ToMilliseconds64(Counters.MaxFlushCycles);
+	Stats.FlushSlices = Counters.FlushSlices;
+
+	Stats.RequestLatencyHistogram.Reserve(FAptabaseStats::NumLatencyBuckets);
+	for (const std::atomic<int64>& NumRequests : Counters.RequestLatencyHistogram)
+	{
+		Stats.RequestLatencyHistogram.Add(NumRequests);
+	}
+
+	return Stats;
+}
+
+void FAptabaseAnalyticsProvider::PublishStats() const
+{
+	SET_DWORD_STAT(STAT_AptabaseQueuedEvents, QueuedEvents);
+	SET_DWORD_STAT(STAT_AptabaseQueuedBytes, QueuedBytes);
+	SET_DWORD_STAT(STAT_AptabaseRequestsInFlight, NumRequestsInFlight);
+	SET_DWORD_STAT(STAT_AptabaseEventsSent, Counters.EventsSent);
+	SET_DWORD_STAT(STAT_AptabaseEventsDropped, NumDroppedEvents);
+	SET_DWORD_STAT(STAT_AptabaseEventsRetried, Counters.EventsRetried);
+
+	CSV_CUSTOM_STAT(Aptabase, QueuedEvents, static_cast<int32>(QueuedEvents), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Aptabase, QueuedBytes, static_cast<int32>(QueuedBytes), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Aptabase, RequestsInFlight, static_cast<int32>(NumRequestsInFlight), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Aptabase, EventsSent, static_cast<int32>(Counters.EventsSent), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Aptabase, EventsDropped, static_cast<int32>(NumDroppedEvents), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Aptabase, LastFlushTimeMs, static_cast<float>(FPlatformTime::ToMilliseconds64(Counters.LastFlushCycles)), ECsvCustomStatOp::Set);
+}
+
+bool FAptabaseAnalyticsProvider::IsOverQueueBudget() const
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+	return QueuedEvents > Settings->MaxQueuedEvents || QueuedBytes > Settings->MaxQueuedBytes;
+}
+
+void FAptabaseAnalyticsProvider::RequestQueueBudgetEnforcement()
+{
+	if (IsInPipelineThread())
+	{
+		EnforceQueueBudget();
+		return;
+	}
+
+	// Only one pending request at a time, however many producers hit the budget before the pipeline thread gets to it
+	if (bQueueBudgetEnforcementRequested.exchange(true))
+	{
+		return;
+	}
+
+	RunOnPipelineThread([](FAptabaseAnalyticsProvider& This)
+	{
+		This.bQueueBudgetEnforcementRequested = false;
+		This.EnforceQueueBudget();
+	});
+}
+
+void FAptabaseAnalyticsProvider::EnforceQueueBudget()
+{
+	check(IsInPipelineThread());
+
+	DrainIncomingEvents();
+
+	if (!IsOverQueueBudget())
+	{
+		return;
+	}
+
+	EAptabaseOverflowPolicy OverflowPolicy = GetDefault<UAptabaseSettings>()->OverflowPolicy;
+	if (OverflowPolicy == EAptabaseOverflowPolicy::SpillToDisk && !Spool.IsValid())
+	{
+		OverflowPolicy = EAptabaseOverflowPolicy::DropOldest;
+	}
+
+	const int64 NumDroppedBefore = NumDroppedEvents;
+
+	switch (OverflowPolicy)
+	{
+	case EAptabaseOverflowPolicy::DropOldest:
+		DropOldestEvents();
+		break;
+	case EAptabaseOverflowPolicy::DropLowestPriority:
+		DropLowestPriorityEvents();
+		break;
+	case EAptabaseOverflowPolicy::SpillToDisk:
+		SpillOldestEvents();
+		break;
+	case EAptabaseOverflowPolicy::DropNewest:
+		// New events are already rejected as they are recorded. Encoded batches are older than anything recorded from now on,
+		// so they are kept and the queue stays over budget, rejecting new events, until they are delivered or discarded.
+		return;
+	default:
+		break;
+	}
+
+	// Encoded batches count against the budget too, the oldest ones waiting for a retry give way first. Critical batches are kept.
+	const int32 NumRetryBatchesBefore = RetryBatches.Num();
+	for (TArray<TSharedRef<FAptabaseEventBatch>>* Batches : {&RetryBatches, &PendingBatches})
+	{
+		while (IsOverQueueBudget())
+		{
+			const int32 BatchIndex = Batches->IndexOfByPredicate([](const TSharedRef<FAptabaseEventBatch>& Batch)
+			{
+				return !Batch->bIsCritical;
+			});
+
+			if (BatchIndex == INDEX_NONE)
+			{
+				break;
+			}
+
+			const TSharedRef<FAptabaseEventBatch> Batch = (*Batches)[BatchIndex];
+			Batches->RemoveAt(BatchIndex);
+			ReleaseQueuedBatch(*Batch);
+
+			if (OverflowPolicy == EAptabaseOverflowPolicy::SpillToDisk && SpillBatch(*Batch))
+			{
+				SpilledBatches.Add(Batch);
+			}
+			else
+			{
+				NumDroppedEvents += Batch->NumEvents;
+				if (Spool.IsValid())
+				{
+					Spool->Acknowledge(*Batch);
+				}
+			}
+		}
+	}
+
+	if (RetryBatches.Num() != NumRetryBatchesBefore)
+	{
+		ScheduleRetryTick();
+	}
+
+	if (NumDroppedEvents > NumDroppedBefore)
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Event queue is full. Dropped %lld events (%lld in total)."), NumDroppedEvents - NumDroppedBefore, NumDroppedEvents.load());
+	}
+}
+
+void FAptabaseAnalyticsProvider::DropOldestEvents()
+{
+	int32 NumToDrop = 0;
+	while (NumToDrop < BatchedEvents.Num() && IsOverQueueBudget())
+	{
+		ReleaseQueuedEvents(1, BatchedEvents.GetAllocatedSize(NumToDrop, 1));
+		++NumToDrop;
+	}
+
+	if (Spool.IsValid())
+	{
+		FAptabaseSpoolRefs DroppedSpoolRefs;
+		BatchedEvents.GetSpoolRefs(0, NumToDrop, DroppedSpoolRefs);
+		Spool->Release(DroppedSpoolRefs);
+	}
+
+	BatchedEvents.RemoveFirst(NumToDrop);
+	NumDroppedEvents += NumToDrop;
+}
+
+void FAptabaseAnalyticsProvider::DropLowestPriorityEvents()
+{
+	FAptabaseSpoolRefs DroppedSpoolRefs;
+	for (uint8 Priority = static_cast<uint8>(EAptabaseEventPriority::Low); Priority <= static_cast<uint8>(EAptabaseEventPriority::Critical) && IsOverQueueBudget(); ++Priority)
+	{
+		// RemoveAll visits the events in order, so the oldest ones of the lowest priority go first
+		const int32 NumDropped = BatchedEvents.RemoveAll([this, Priority, &DroppedSpoolRefs](int32 Index)
+		{
+			if (static_cast<uint8>(BatchedEvents.GetPriority(Index)) != Priority || !IsOverQueueBudget())
+			{
+				return false;
+			}
+
+			ReleaseQueuedEvents(1, BatchedEvents.GetAllocatedSize(Index, 1));
+			DroppedSpoolRefs.Add(BatchedEvents.GetSpoolId(Index));
+			return true;
+		});
+
+		NumDroppedEvents += NumDropped;
+	}
+
+	if (Spool.IsValid())
+	{
+		Spool->Release(DroppedSpoolRefs);
+	}
+}
+
+void FAptabaseAnalyticsProvider::SpillOldestEvents()
+{
+	int32 NumSpilled = 0;
+	while (NumSpilled < BatchedEvents.Num() && IsOverQueueBudget())
+	{
+		const TSharedRef<FAptabaseEventBatch> Batch = EncodeNextBatch(BatchedEvents, NumSpilled);
+		if (!SpillBatch(*Batch))
+		{
+			break;
+		}
+
+		SpilledBatches.Add(Batch);
+
+		ReleaseQueuedEvents(Batch->NumEvents, BatchedEvents.GetAllocatedSize(NumSpilled, Batch->NumEvents));
+		NumSpilled += Batch->NumEvents;
+	}
+
+	BatchedEvents.RemoveFirst(NumSpilled);
+
+	if (IsOverQueueBudget())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Failed to spill events to disk. Dropping the oldest ones instead."));
+		DropOldestEvents();
+	}
+}
+
+bool FAptabaseAnalyticsProvider::SpillBatch(FAptabaseEventBatch& Batch)
+{
+	// The events move from their journal records to a record holding exactly this body, which is read back once there is room again
+	if (!Spool->IsPersisted(Batch))
+	{
+		const FAptabaseSpoolRefs JournalRefs = Batch.SpoolRefs;
+		if (!Spool->Append(Batch))
+		{
+			Batch.SpoolId = 0;
+			return false;
+		}
+
+		Batch.SpoolRefs.Reset();
+		Batch.SpoolRefs.Add(Batch.SpoolId, Batch.NumEvents);
+		Spool->Release(JournalRefs);
+	}
+
+	// Only the spool id stays in memory
+	Batch.Body.Empty();
+	Batch.CompressedBody.Empty();
+	return true;
+}
+
+void FAptabaseAnalyticsProvider::ReleaseQueuedEvents(int32 NumEvents, int64 NumBytes)
+{
+	QueuedEvents -= NumEvents;
+	QueuedBytes -= NumBytes;
+}
+
+void FAptabaseAnalyticsProvider::TrackQueuedBatch(const FAptabaseEventBatch& Batch)
+{
+	QueuedEvents += Batch.NumEvents;
+	QueuedBytes += Batch.GetAllocatedSize();
+}
+
+void FAptabaseAnalyticsProvider::ReleaseQueuedBatch(const FAptabaseEventBatch& Batch)
+{
+	QueuedEvents -= Batch.NumEvents;
+	QueuedBytes -= Batch.GetAllocatedSize();
+}
+
+void FAptabaseAnalyticsProvider::SetUserID(const FString& InUserID)
+{
+	UE_LOG(LogAptabase, Log, TEXT("Aptabase is a privacy-first solution and will NOT send the UserId to the backend. Discarding user id set request."));
+
+	UserId = InUserID;
+}
+
+FString FAptabaseAnalyticsProvider::GetUserID() const
+{
+	return UserId;
+}
+
+void FAptabaseAnalyticsProvider::RecordEvent(const FString& EventName, const TArray<FAnalyticsEventAttribute>& Attributes)
+{
+	RecordSessionEvent(FAptabaseSessionHandle(), EventName, Attributes);
+}
+
+void FAptabaseAnalyticsProvider::RecordSessionEvent(FAptabaseSessionHandle Session, const FString& EventName, const TArray<FAnalyticsEventAttribute>& Attributes)
+{
+	LLM_SCOPE_BYTAG(Aptabase);
+	SCOPE_CYCLE_COUNTER(STAT_AptabaseRecordEvent);
+	FAptabaseScopedCycleCounter RecordCycleCounter(Counters.RecordCycles);
+
+	FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+	RecordEventInternal(Session, EventName, EAptabaseEventPriority::Normal, [&NameTable, &Attributes](FAptabaseEventAttributeArray& OutAttributes)
+	{
+		OutAttributes.Reserve(Attributes.Num());
+		for (const FAnalyticsEventAttribute& Attribute : Attributes)
+		{
+			FAptabaseEventAttribute& NewAttribute = OutAttributes.Emplace_GetRef();
+			NewAttribute.Key = NameTable.Intern(Attribute.GetName());
+			ConvertAttributeValue(Attribute, NewAttribute);
+		}
+	});
+}
+
+void FAptabaseAnalyticsProvider::RecordEventInternal(FAptabaseSessionHandle Session, const FString& EventName, EAptabaseEventPriority Priority, TFunctionRef<void(FAptabaseEventAttributeArray&)> MakeAttributes)
+{
+	APTABASE_TRACE_SCOPE(FAptabaseAnalyticsProvider::RecordEventInternal);
+
+	if (!bHasActiveSession)
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("No session is currently active. Discarding event."));
+		return;
+	}
+
+	// The provider's own session is tagged when the event is drained, so a refresh applies to the events recorded before it too
+	TSharedPtr<const FAptabaseSessionSnapshot> SessionSnapshotToTag;
+	uint32 SessionSeed = DefaultSessionSeed;
+	if (!Session.IsDefault())
+	{
+		SessionSnapshotToTag = FindSession(Session);
+		if (!SessionSnapshotToTag.IsValid())
+		{
+			UE_LOG(LogAptabase, Warning, TEXT("Session handle %u is not active. Discarding event."), Session.Id);
+			return;
+		}
+
+		SessionSeed = FCrc::StrCrc32(*SessionSnapshotToTag->SessionId);
+	}
+
+	// Rejected events are dropped before anything is allocated for them, attributes included
+	double SampleWeight = 1.0;
+	switch (Sampler.Sample(EventName, SessionSeed, SampleWeight))
+	{
+	case EAptabaseSamplingDecision::SampledOut:
+		++Counters.EventsSampledOut;
+		return;
+	case EAptabaseSamplingDecision::RateLimited:
+		++Counters.EventsRateLimited;
+		UE_LOG(LogAptabase, VeryVerbose, TEXT("Rate limit exceeded. Discarding event (%s)."), *EventName);
+		return;
+	case EAptabaseSamplingDecision::Keep:
+	default:
+		break;
+	}
+
+	FAptabaseEventPayload EventPayload;
+	EventPayload.Session = MoveTemp(SessionSnapshotToTag);
+	EventPayload.EventName = FAptabaseNameTable::Get().Intern(EventName);
+	EventPayload.TimeStamp = FDateTime::UtcNow();
+	EventPayload.Priority = Priority;
+	MakeAttributes(EventPayload.EventAttributes);
+
+	// Names that didn't fit in the name table would be sent empty, the event is dropped rather than corrupted
+	const bool bHasInvalidName = !EventPayload.EventName.IsValid() || EventPayload.EventAttributes.ContainsByPredicate([](const FAptabaseEventAttribute& Attribute)
+	{
+		return !Attribute.Key.IsValid();
+	});
+
+	if (bHasInvalidName)
+	{
+		NumDroppedEvents += 1;
+		UE_LOG(LogAptabase, Verbose, TEXT("Name table is full. Discarding event (%s)."), *EventName);
+		return;
+	}
+
+	++Counters.EventsRecorded;
+
+	if (SampleWeight != 1.0 && SampleWeightKey.IsValid())
+	{
+		FAptabaseEventAttribute& SampleWeightAttribute = EventPayload.EventAttributes.Emplace_GetRef();
+		SampleWeightAttribute.Key = SampleWeightKey;
+		SampleWeightAttribute.Value.Set<double>(SampleWeight);
+	}
+
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+	const int64 EventBytes = EventPayload.GetAllocatedSize();
+	const int64 NewQueuedEvents = QueuedEvents.fetch_add(1) + 1;
+	const int64 NewQueuedBytes = QueuedBytes.fetch_add(EventBytes) + EventBytes;
+	const bool bOverBudget = NewQueuedEvents > Settings->MaxQueuedEvents || NewQueuedBytes > Settings->MaxQueuedBytes;
+	const bool bIsCritical = Priority == EAptabaseEventPriority::Critical;
+
+	if (bOverBudget && !bIsCritical && Settings->OverflowPolicy == EAptabaseOverflowPolicy::DropNewest)
+	{
+		QueuedEvents -= 1;
+		QueuedBytes -= EventBytes;
+		NumDroppedEvents += 1;
+
+		UE_LOG(LogAptabase, Verbose, TEXT("Event queue is full. Discarding event (%s)."), *EventName);
+		return;
+	}
+
+	UE_LOG(LogAptabase, Verbose, TEXT("Batching event (%s) for next flush."), *EventName);
+	IncomingEvents.Enqueue(MoveTemp(EventPayload));
+
+	if (bOverBudget)
+	{
+		RequestQueueBudgetEnforcement();
+	}
+
+	// Only the first event after a flush and the one reaching the threshold wake the pipeline thread, the others just queue up
+	const int32 NumUnflushed = NumUnflushedEvents.fetch_add(1) + 1;
+	if (NumUnflushed == 1)
+	{
+		ScheduleFlush(GetSendInterval());
+	}
+	if (NumUnflushed == Settings->FlushEventThreshold)
+	{
+		ScheduleFlush(0.0);
+	}
+
+	// The spool doesn't wait for the flush, events are journaled within PersistInterval of being recorded
+	if (Settings->bPersistEvents && NumUnpersistedEvents.fetch_add(1) == 0)
+	{
+		SchedulePersist();
+	}
+
+	// Critical events don't wait for the send interval, ScheduleFlush only ever brings the flush forward
+	if (bIsCritical)
+	{
+		ScheduleFlush(Settings->CriticalSendInterval);
+	}
+}
+
+TSharedRef<const FAptabaseSessionSnapshot> FAptabaseAnalyticsProvider::MakeSessionSnapshot(const FString& InSessionId, const FAptabaseSessionProperties& Properties)
+{
+	const TSharedPtr<IPlugin> AptabasePlugin = IPluginManager::Get().FindPlugin("Aptabase");
+
+	// Properties of a remote player take precedence over those of the machine running the provider
+	const TSharedRef<FAptabaseSessionSnapshot> Snapshot = MakeShared<FAptabaseSessionSnapshot>();
+	Snapshot->SessionId = InSessionId;
+	Snapshot->Properties = Properties;
+	Snapshot->SystemProps.Locale = !Properties.Locale.IsEmpty() ? Properties.Locale : UKismetInternationalizationLibrary::GetCurrentLocale();
+	Snapshot->SystemProps.AppVersion = !Properties.AppVersion.IsEmpty() ? Properties.AppVersion : GetDefault<UGeneralProjectSettings>()->ProjectVersion;
+	Snapshot->SystemProps.SdkVersion = FString::Printf(TEXT("aptabase-unreal@%s"), *AptabasePlugin->GetDescriptor().VersionName);
+	Snapshot->SystemProps.OsName = !Properties.OsName.IsEmpty() ? Properties.OsName : UGameplayStatics::GetPlatformName();
+	Snapshot->SystemProps.OsVersion = !Properties.OsVersion.IsEmpty() ? Properties.OsVersion : FPlatformMisc::GetOSVersion();
+	Snapshot->SystemProps.IsDebug = !IsInReleaseMode();
+
+	return Snapshot;
+}
+
+int32 FAptabaseAnalyticsProvider::SendEventsNow(const FAptabaseEventBuffer& Events, int32 FirstIndex, uint64 EndCycles, bool bIsCritical)
+{
+	APTABASE_TRACE_SCOPE(FAptabaseAnalyticsProvider::SendEventsNow);
+
+	while (FirstIndex < Events.Num())
+	{
+		const TSharedRef<FAptabaseEventBatch> Batch = EncodeNextBatch(Events, FirstIndex);
+
+		UE_LOG(LogAptabase, VeryVerbose, TEXT("Queuing batch of %d bytes containing:"), Batch->Body.Num());
+		for (int32 Index = FirstIndex; Index < FirstIndex + Batch->NumEvents; ++Index)
+		{
+			UE_LOG(LogAptabase, VeryVerbose, TEXT("Event: %s"), *FAptabaseNameTable::Get().Resolve(Events.GetEventName(Index)).String);
+		}
+
+		Batch->bIsCritical = bIsCritical;
+		EnqueueBatch(Batch);
+		FirstIndex += Batch->NumEvents;
+
+		// Checked after the batch, so a flush always makes progress however small its budget
+		if (FPlatformTime::Cycles64() >= EndCycles)
+		{
+			break;
+		}
+	}
+
+	DispatchPendingBatches();
+	return FirstIndex;
+}
+
+TSharedRef<FAptabaseEventBatch> FAptabaseAnalyticsProvider::EncodeNextBatch(const FAptabaseEventBuffer& Events, int32 FirstIndex)
+{
+	check(FirstIndex < Events.Num());
+
+	const int32 TargetBatchBytes = GetDefault<UAptabaseSettings>()->TargetBatchBytes;
+
+	// The batch is closed once it reaches the target size, so it overshoots by at most one event
+	FDateTime OldestEventTime = FDateTime::MaxValue();
+	Serializer.BeginBatch();
+	for (int32 Index = FirstIndex; Index < Events.Num(); ++Index)
+	{
+		Serializer.WriteEvent(Events, Index);
+		OldestEventTime = FMath::Min(OldestEventTime, Events.GetTimeStamp(Index));
+
+		if (Serializer.GetNumEvents() >= MaxEventsPerRequest || Serializer.GetNumBytes() >= TargetBatchBytes)
+		{
+			break;
+		}
+	}
+
+	const TSharedRef<FAptabaseEventBatch> Batch = MakeShared<FAptabaseEventBatch>();
+	Batch->NumEvents = Serializer.GetNumEvents();
+	Batch->Body = Serializer.EndBatch();
+	Batch->OldestEventTime = OldestEventTime;
+	Events.GetSpoolRefs(FirstIndex, Batch->NumEvents, Batch->SpoolRefs);
+
+	return Batch;
+}
+
+void FAptabaseAnalyticsProvider::EnqueueBatch(const TSharedRef<FAptabaseEventBatch>& Batch)
+{
+	if (Batch->bIsCritical)
+	{
+		int32 InsertIndex = 0;
+		while (InsertIndex < PendingBatches.Num() && PendingBatches[InsertIndex]->bIsCritical)
+		{
+			++InsertIndex;
+		}
+
+		PendingBatches.Insert(Batch, InsertIndex);
+	}
+	else
+	{
+		PendingBatches.Add(Batch);
+	}
+	TrackQueuedBatch(*Batch);
+
+	if (IsOverQueueBudget())
+	{
+		EnforceQueueBudget();
+	}
+}
+
+void FAptabaseAnalyticsProvider::DispatchPendingBatches()
+{
+	// Hold everything back while the backend asked us to, the retry ticker dispatches again once it is due
+	if (FPlatformTime::Seconds() < BackendUnavailableUntil)
+	{
+		return;
+	}
+
+	// A request completing from inside SendBatch lands back here, the loop below already picks up the slot it freed
+	if (bIsDispatchingBatches)
+	{
+		return;
+	}
+	TGuardValue<bool> DispatchGuard(bIsDispatchingBatches, true);
+
+	const int32 MaxConcurrentRequests = FMath::Max(1, GetDefault<UAptabaseSettings>()->MaxConcurrentRequests);
+
+	while (NumRequestsInFlight < MaxConcurrentRequests)
+	{
+		// Spilled batches are the oldest, but only come back from disk while nothing is failing, otherwise they'd just be spilled again
+		if (!SpilledBatches.IsEmpty() && RetryBatches.IsEmpty() && !IsOverQueueBudget())
+		{
+			const TSharedRef<FAptabaseEventBatch> Batch = SpilledBatches[0];
+			SpilledBatches.RemoveAt(0);
+
+			if (Spool->Load(*Batch))
+			{
+				SendBatch(Batch);
+			}
+			else
+			{
+				NumDroppedEvents += Batch->NumEvents;
+			}
+			continue;
+		}
+
+		if (PendingBatches.IsEmpty())
+		{
+			break;
+		}
+
+		const TSharedRef<FAptabaseEventBatch> Batch = PendingBatches[0];
+		PendingBatches.RemoveAt(0);
+		ReleaseQueuedBatch(*Batch);
+
+		SendBatch(Batch);
+	}
+}
+
+void FAptabaseAnalyticsProvider::SendBatch(const TSharedRef<FAptabaseEventBatch>& Batch)
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+
+	const TArray<uint8>& RequestBody = Batch->Body;
+
+	// Byte stats are counted once per batch, retries and the uncompressed resend after a rejection come back through here
+	const bool bIsFirstAttempt = Batch->NumAttempts == 0;
+	if (bIsFirstAttempt)
+	{
+		Counters.BytesBeforeCompression += RequestBody.Num();
+	}
+
+	const bool bShouldCompress = Settings->bCompressRequests && !bCompressionRejected && Transport->SupportsCompression() && RequestBody.Num() >= Settings->CompressionThreshold;
+	if (bShouldCompress && Batch->CompressedBody.IsEmpty() && !CompressGzip(RequestBody, Batch->CompressedBody))
+	{
+		Batch->CompressedBody.Reset();
+	}
+
+	TArray<uint8> SentBody;
+	const bool bCompressed = bShouldCompress && !Batch->CompressedBody.IsEmpty() && Batch->CompressedBody.Num() < RequestBody.Num();
+	if (bCompressed)
+	{
+		UE_LOG(LogAptabase, VeryVerbose, TEXT("Compressed batch from %d to %d bytes."), RequestBody.Num(), Batch->CompressedBody.Num());
+		SentBody = MoveTemp(Batch->CompressedBody);
+	}
+	else
+	{
+		SentBody = MoveTemp(Batch->Body);
+	}
+
+	if (bIsFirstAttempt)
+	{
+		Counters.BytesUploaded += SentBody.Num();
+	}
+	++Batch->NumAttempts;
+	++NumRequestsInFlight;
+	Batch->LastAttemptTime = FPlatformTime::Seconds();
+
+	// Bound weakly, a request can outlive the provider when the application shuts down. With the worker, completions skip
+	// the round-trip through the game thread and OnEventsRecoded hands them over to the worker.
+	FOnAptabaseTransportComplete OnComplete = FOnAptabaseTransportComplete::CreateSP(this, &FAptabaseAnalyticsProvider::OnEventsRecoded, Batch);
+
+	AptabaseTrace::OutputBatchSent(reinterpret_cast<UPTRINT>(&Batch.Get()), Batch->NumEvents, SentBody.Num(), Batch->NumAttempts);
+	const TSharedRef<IAptabaseTransportRequest> Request = Transport->CreateRequest(MoveTemp(SentBody), bCompressed, MoveTemp(OnComplete));
+
+	// Tracked before it starts, the completion may run from inside Process and must find it
+	InFlightRequests.Add(Batch, Request);
+	Request->Process();
+}
+
+void FAptabaseAnalyticsProvider::OnEventsRecoded(const FAptabaseTransportResponse& Response, TSharedRef<FAptabaseEventBatch> Batch)
+{
+	if (!IsInPipelineThread())
+	{
+		RunOnPipelineThread([Response, Batch](FAptabaseAnalyticsProvider& This)
+		{
+			This.OnEventsRecoded(Response, Batch);
+		});
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(Aptabase);
+	APTABASE_TRACE_SCOPE(FAptabaseAnalyticsProvider::OnEventsRecoded);
+
+	// The batch was handed over to the persistence hook by Drain in the meantime
+	const TSharedRef<IAptabaseTransportRequest>* InFlightRequest = InFlightRequests.Find(Batch);
+	if (!InFlightRequest)
+	{
+		return;
+	}
+
+	const TSharedRef<IAptabaseTransportRequest> Request = *InFlightRequest;
+	InFlightRequests.Remove(Batch);
+
+	--NumRequestsInFlight;
+	const double Latency = FPlatformTime::Seconds() - Batch->LastAttemptTime;
+	Counters.AddRequestLatency(Latency);
+	AptabaseTrace::OutputBatchCompleted(reinterpret_cast<UPTRINT>(&Batch.Get()), Batch->NumEvents, Response.bWasDelivered ? Response.StatusCode : 0, Latency);
+
+	// Whatever happened to this batch, its slot is free for the next one
+	ON_SCOPE_EXIT
+	{
+		DispatchPendingBatches();
+		PublishStats();
+	};
+
+	if (!Response.bWasDelivered)
+	{
+		UE_LOG(LogAptabase, Error, TEXT("Request to record the event was unsuccessful."));
+		RetryOrDiscardBatch(*Request, Batch, {});
+		return;
+	}
+
+	const int32 ResponseCode = Response.StatusCode;
+	if (!EHttpResponseCodes::IsOk(ResponseCode))
+	{
+		UE_LOG(LogAptabase, Error, TEXT("Request to record the event received unexpected code: %s"), *LexToString(ResponseCode));
+
+		if ((ResponseCode == EHttpResponseCodes::BadRequest || ResponseCode == EHttpResponseCodes::UnsupportedMedia) && Request->IsCompressed())
+		{
+			UE_LOG(LogAptabase, Warning, TEXT("Compressed request was rejected. Disabling compression and re-sending the events uncompressed."));
+			bCompressionRejected = true;
+			SendBatch(Batch);
+			return;
+		}
+
+		if (ResponseCode == EHttpResponseCodes::TooManyRequests)
+		{
+			UE_LOG(LogAptabase, Warning, TEXT("Backend is rate limiting requests. Event will be retried later."))
+			RetryOrDiscardBatch(*Request, Batch, FAptabaseRetryPolicy::ParseRetryAfter(Response.RetryAfter));
+			return;
+		}
+
+		if (ResponseCode >= 400 && ResponseCode < 500)
+		{
+			UE_LOG(LogAptabase, Error, TEXT("Data was sent in the wrong format. Event will be skipped."))
+			Counters.EventsDiscarded += Batch->NumEvents;
+		}
+		else if (ResponseCode >= 500)
+		{
+			UE_LOG(LogAptabase, Error, TEXT("Server-side issue. Event will be retried later."))
+			RetryOrDiscardBatch(*Request, Batch, FAptabaseRetryPolicy::ParseRetryAfter(Response.RetryAfter));
+			return;
+		}
+	}
+	else
+	{
+		UE_LOG(LogAptabase, VeryVerbose, TEXT("Event recorded successfully."));
+		Counters.EventsSent += Batch->NumEvents;
+	}
+
+	if (Spool.IsValid())
+	{
+		Spool->Acknowledge(*Batch);
+	}
+}
+
+void FAptabaseAnalyticsProvider::RetryOrDiscardBatch(const IAptabaseTransportRequest& Request, const TSharedRef<FAptabaseEventBatch>& Batch, TOptional<double> RetryAfter)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	if (!FAptabaseRetryPolicy::ScheduleRetry(*Batch, Now, RetryAfter))
+	{
+		UE_LOG(LogAptabase, Error, TEXT("Batch of %d events failed %d times. Events will be skipped."), Batch->NumEvents, Batch->NumAttempts);
+		Counters.EventsDiscarded += Batch->NumEvents;
+
+		if (Spool.IsValid())
+		{
+			Spool->Acknowledge(*Batch);
+		}
+		return;
+	}
+
+	if (RetryAfter.IsSet())
+	{
+		BackendUnavailableUntil = FMath::Max(BackendUnavailableUntil, Now + RetryAfter.GetValue());
+	}
+
+	// Only batches that are retried get their body back
+	RestoreRequestBody(Request, *Batch);
+
+	UE_LOG(LogAptabase, Verbose, TEXT("Retrying batch of %d events in %.1f seconds."), Batch->NumEvents, Batch->NextAttemptTime - Now);
+	Counters.EventsRetried += Batch->NumEvents;
+	AddRetryBatch(Batch);
+}
+
+void FAptabaseAnalyticsProvider::AddRetryBatch(const TSharedRef<FAptabaseEventBatch>& Batch)
+{
+	// HTTP completions are handed over to the pipeline thread, which owns RetryBatches
+	RetryBatches.Add(Batch);
+	TrackQueuedBatch(*Batch);
+	ScheduleRetryTick();
+
+	if (IsOverQueueBudget())
+	{
+		EnforceQueueBudget();
+	}
+}
+
+void FAptabaseAnalyticsProvider::ScheduleRetryTick()
+{
+	FTSTicker::RemoveTicker(RetryTickerHandle);
+	RetryTickerHandle.Reset();
+
+	if (RetryBatches.IsEmpty())
+	{
+		return;
+	}
+
+	double NextAttemptTime = TNumericLimits<double>::Max();
+	for (const TSharedRef<FAptabaseEventBatch>& Batch : RetryBatches)
+	{
+		NextAttemptTime = FMath::Min(NextAttemptTime, Batch->NextAttemptTime);
+	}
+
+	const float Delay = FMath::Max(0.0, NextAttemptTime - FPlatformTime::Seconds());
+	RetryTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FAptabaseAnalyticsProvider::OnRetryTick), Delay);
+}
+
+bool FAptabaseAnalyticsProvider::OnRetryTick(float DeltaTime)
+{
+	if (IsInPipelineThread())
+	{
+		SendDueRetryBatches();
+	}
+	else
+	{
+		RunOnPipelineThread([](FAptabaseAnalyticsProvider& This)
+		{
+			This.SendDueRetryBatches();
+		});
+	}
+
+	// One-shot, ScheduleRetryTick registers a new ticker for the next due batch
+	return false;
+}
+
+void FAptabaseAnalyticsProvider::SendDueRetryBatches()
+{
+	LLM_SCOPE_BYTAG(Aptabase);
+
+	RetryTickerHandle.Reset();
+
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<TSharedRef<FAptabaseEventBatch>> DueBatches;
+	for (int32 BatchIndex = RetryBatches.Num() - 1; BatchIndex >= 0; --BatchIndex)
+	{
+		if (RetryBatches[BatchIndex]->NextAttemptTime <= Now)
+		{
+			ReleaseQueuedBatch(*RetryBatches[BatchIndex]);
+			DueBatches.Add(RetryBatches[BatchIndex]);
+			RetryBatches.RemoveAt(BatchIndex, EAllowShrinking::No);
+		}
+	}
+
+	// Retries go ahead of newer batches, oldest first (the loop above collected them in reverse)
+	for (const TSharedRef<FAptabaseEventBatch>& Batch : DueBatches)
+	{
+		PendingBatches.Insert(Batch, 0);
+		TrackQueuedBatch(*Batch);
+	}
+
+	ScheduleRetryTick();
+	DispatchPendingBatches();
+}
+
+void FAptabaseAnalyticsProvider::Drain(double Timeout)
+{
+	LLM_SCOPE_BYTAG(Aptabase);
+
+	const double Deadline = FPlatformTime::Seconds() + Timeout;
+	double LastTickTime = FPlatformTime::Seconds();
+
+	bool bHasUndeliveredBatches = true;
+	while (true)
+	{
+		RunOnPipelineThreadAndWait([this, &bHasUndeliveredBatches]()
+		{
+			bHasUndeliveredBatches = HasUndeliveredBatches();
+		});
+
+		const double Now = FPlatformTime::Seconds();
+		if (!bHasUndeliveredBatches || Now >= Deadline)
+		{
+			break;
+		}
+
+		// The core ticker doesn't run while the game thread is blocked in here, so requests would never complete
+		if (IsInGameThread())
+		{
+			Transport->Tick(Now - LastTickTime);
+		}
+
+		LastTickTime = Now;
+		FPlatformProcess::Sleep(DrainPollInterval);
+	}
+
+	RunOnPipelineThreadAndWait([this]()
+	{
+		HandOverUnsentBatches();
+		PublishStats();
+	});
+}
+
+bool FAptabaseAnalyticsProvider::HasUndeliveredBatches() const
+{
+	check(IsInPipelineThread());
+
+	// Pending batches held back by a Retry-After won't go anywhere before the deadline
+	return NumRequestsInFlight > 0 || (!PendingBatches.IsEmpty() && FPlatformTime::Seconds() >= BackendUnavailableUntil);
+}
+
+void FAptabaseAnalyticsProvider::HandOverUnsentBatches()
+{
+	check(IsInPipelineThread());
+
+	TArray<TSharedRef<FAptabaseEventBatch>> UnsentBatches;
+
+	// Cancelling may complete the request right away, so the map is taken over first and the completion finds nothing
+	const TMap<TSharedRef<FAptabaseEventBatch>, TSharedRef<IAptabaseTransportRequest>> AbandonedRequests = MoveTemp(InFlightRequests);
+	InFlightRequests.Reset();
+	NumRequestsInFlight -= AbandonedRequests.Num();
+
+	for (const TPair<TSharedRef<FAptabaseEventBatch>, TSharedRef<IAptabaseTransportRequest>>& AbandonedRequest : AbandonedRequests)
+	{
+		AbandonedRequest.Value->Cancel();
+		RestoreRequestBody(*AbandonedRequest.Value, *AbandonedRequest.Key);
+		UnsentBatches.Add(AbandonedRequest.Key);
+	}
+
+	for (TArray<TSharedRef<FAptabaseEventBatch>>* Batches : {&PendingBatches, &RetryBatches})
+	{
+		for (const TSharedRef<FAptabaseEventBatch>& Batch : *Batches)
+		{
+			ReleaseQueuedBatch(*Batch);
+			UnsentBatches.Add(Batch);
+		}
+
+		Batches->Empty();
+	}
+
+	ScheduleRetryTick();
+
+	if (UnsentBatches.IsEmpty())
+	{
+		return;
+	}
+
+	int32 NumUnsentEvents = 0;
+	for (const TSharedRef<FAptabaseEventBatch>& Batch : UnsentBatches)
+	{
+		NumUnsentEvents += Batch->NumEvents;
+		UnsentBatchDelegate.Broadcast(Batch->Body, Batch->NumEvents);
+	}
+
+	if (Spool.IsValid())
+	{
+		UE_LOG(LogAptabase, Log, TEXT("%d events were not delivered in time. They stay in the spool and will be sent by the next session."), NumUnsentEvents);
+	}
+	else if (!UnsentBatchDelegate.IsBound())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("%d events were not delivered in time and are lost. Enable bPersistEvents to send them with the next session."), NumUnsentEvents);
+	}
+}
+
+void FAptabaseAnalyticsProvider::RunOnPipelineThreadAndWait(TUniqueFunction<void()>&& Function)
+{
+	if (Worker.IsValid())
+	{
+		Worker->EnqueueAndWait(MoveTemp(Function));
+		return;
+	}
+
+	check(IsInGameThread());
+	Function();
+}
+
+bool FAptabaseAnalyticsProvider::IsInPipelineThread() const
+{
+	return Worker.IsValid() ? Worker->IsInWorkerThread() : IsInGameThread();
+}
+
+void FAptabaseAnalyticsProvider::RunOnPipelineThread(TUniqueFunction<void(FAptabaseAnalyticsProvider&)>&& Function)
+{
+	TUniqueFunction<void()> Task = [WeakThis = AsWeak(), Function = MoveTemp(Function)]()
+	{
+		if (const TSharedPtr<FAptabaseAnalyticsProvider> This = WeakThis.Pin())
+		{
+			LLM_SCOPE_BYTAG(Aptabase);
+			Function(*This);
+		}
+	};
+
+	if (Worker.IsValid())
+	{
+		Worker->Enqueue(MoveTemp(Task));
+	}
+	else
+	{
+		AsyncTask(ENamedThreads::GameThread, MoveTemp(Task));
+	}
 }
 
 void FAptabaseAnalyticsProvider::SetDefaultEventAttributes(TArray<FAnalyticsEventAttribute>&& Attributes)
@@ -1,25 +1,76 @@
 #pragma once
 
-#include <Engine/TimerHandle.h>
-#include <Interfaces/IAnalyticsProvider.h>
-#include <Interfaces/IHttpRequest.h>
+#include <Containers/Queue.h>
+#include <Containers/Ticker.h>
+#include <HAL/CriticalSection.h>
 
+#include <atomic>
+
+#include "AptabaseAnalytics.h"
+#include "AptabaseCounters.h"
 #include "AptabaseData.h"
+#include "AptabaseEventAggregator.h"
+#include "AptabaseEventBuffer.h"
+#include "AptabaseEventSampler.h"
+#include "AptabaseEventSerializer.h"
+#include "AptabaseReadEpochs.h"
 
+class FAptabaseEventSpool;
+class FAptabaseWorker;
+class IAptabaseTransport;
+class IAptabaseTransportRequest;
+struct FAptabaseTransportResponse;
+struct FExtendedAnalyticsEvent;
 struct FExtendedAnalyticsEventAttribute;
 
 /**
  *  Implementation of Aptabase Analytics provider
+ *  @note Events can be recorded from any thread. Flushing and sending are handled on the pipeline thread: the game thread,
+ *  or a dedicated worker when bUseBackgroundWorker is enabled.
  */
-class FAptabaseAnalyticsProvider final : public IAnalyticsProvider
+class FAptabaseAnalyticsProvider final : public IAptabaseAnalytics, public TSharedFromThis<FAptabaseAnalyticsProvider>
 {
 public:
+	FAptabaseAnalyticsProvider();
+	/**
+	 * @param InTransport Delivers the batches instead of the transport selected in the settings
+	 */
+	explicit FAptabaseAnalyticsProvider(TUniquePtr<IAptabaseTransport>&& InTransport);
+	virtual ~FAptabaseAnalyticsProvider() override;
+	// Begin IAptabaseAnalytics Interface
+	virtual void RecordExtendedEvent(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) override;
+	virtual void RecordExtendedEvent(const FString& EventName, TArray<FExtendedAnalyticsEventAttribute>&& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) override;
+	virtual void RecordExtendedEvents(TConstArrayView<FExtendedAnalyticsEvent> Events) override;
+	virtual FAptabaseSessionHandle CreateSession(const FAptabaseSessionProperties& Properties = FAptabaseSessionProperties()) override;
+	virtual void EndSession(FAptabaseSessionHandle Session) override;
+	virtual FString GetSessionID(FAptabaseSessionHandle Session) const override;
+	virtual void RecordSessionEvent(FAptabaseSessionHandle Session, const FString& EventName, const TArray<FAnalyticsEventAttribute>& Attributes) override;
+	virtual void RecordSessionExtendedEvent(FAptabaseSessionHandle Session, const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) override;
+	virtual void RecordSessionExtendedEvent(FAptabaseSessionHandle Session, const FString& EventName, TArray<FExtendedAnalyticsEventAttribute>&& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) override;
+	virtual FAptabaseStats GetStats() const override;
+	virtual void Drain(double Timeout) override;
+	virtual FOnAptabaseUnsentBatch& OnUnsentBatch() override { return UnsentBatchDelegate; }
+	// End IAptabaseAnalytics Interface
 	/**
-	 * Overload for RecordEvent that takes an array of ExtendedAttributes
+	 * @brief Replaces the sampling rules of the settings until they are edited or reloaded
+	 * @note Callable from any thread
 	 */
-	void RecordExtendedEvent(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes);
+	void SetSamplingRules(TConstArrayView<FAptabaseSamplingRule> Rules);
+	/**
+	 * @brief Captures a fresh snapshot of the system properties for the active session
+	 * @note Called automatically when the current culture changes. Events recorded before the refresh keep their previous snapshot.
+	 */
+	void RefreshSystemProperties();
+	/**
+	 * @brief Number of events discarded so far because the event queue was over its budget, or their names didn't fit in the name table
+	 */
+	int64 GetNumDroppedEvents() const;
 
 private:
+	/**
+	 * @brief Snapshots of the sessions started with CreateSession, by handle id
+	 */
+	using FSessionMap = TMap<uint32, TSharedRef<const FAptabaseSessionSnapshot>>;
 	// Being IAnalyticsProvider Interface
 	virtual bool StartSession(const TArray<FAnalyticsEventAttribute>& Attributes) override;
 	virtual void EndSession() override;
@@ -35,17 +86,187 @@ private:
 	virtual FAnalyticsEventAttribute GetDefaultEventAttribute(int AttributeIndex) const override;
 	// End IAnalyticsProvider Interface
 	/**
-	 * @brief Instantly sends an Aptabase event to the backend
+	 * @brief Whether the caller runs on the thread owning the batches and requests
+	 */
+	bool IsInPipelineThread() const;
+	/**
+	 * @brief Runs the function on the pipeline thread later on, unless the provider is destroyed first
 	 */
-	void SendEventsNow(const TArray<FAptabaseEventPayload>& EventPayloads);
+	void RunOnPipelineThread(TUniqueFunction<void(FAptabaseAnalyticsProvider&)>&& Function);
+	/**
+	 * @brief Sets the pipeline up for a new session
+	 */
+	void StartPipeline(const TSharedRef<const FAptabaseSessionSnapshot>& Snapshot);
+	/**
+	 * @brief Runs the function on the pipeline thread and blocks until it is done
+	 * @note Without the worker, must be called from the game thread
+	 */
+	void RunOnPipelineThreadAndWait(TUniqueFunction<void()>&& Function);
+	/**
+	 * @brief Whether requests are in flight or batches can still be dispatched
+	 */
+	bool HasUndeliveredBatches() const;
+	/**
+	 * @brief Gives up on the requests in flight and the queued batches, and hands them to UnsentBatchDelegate
+	 */
+	void HandOverUnsentBatches();
+	/**
+	 * @brief Applies the sampling rules of the settings after they changed at runtime
+	 */
+	void OnSamplingRulesChanged();
+	/**
+	 * @brief Makes sure a flush happens within Delay seconds, callable from any thread
+	 */
+	void ScheduleFlush(double Delay);
+	/**
+	 * @brief Flushes the events once the scheduled delay elapsed
+	 */
+	bool OnFlushTick(float DeltaTime);
+	/**
+	 * @brief Longest time an event waits before being flushed, for the current build configuration
+	 */
+	static double GetSendInterval();
+	/**
+	 * @brief Moves BatchedEvents and the completed aggregation windows to FlushingEvents, and releases them from the queue budget
+	 */
+	void BeginFlush();
+	/**
+	 * @brief Encodes the events from FirstIndex on into size-bounded batches and sends them as request slots become available
+	 * @param EndCycles Stops encoding once FPlatformTime::Cycles64 reaches it, after at least one batch
+	 * @param bIsCritical Whether the batches go ahead of the ones already waiting
+	 * @return Index of the first event left to encode, Events.Num() once all of them are
+	 */
+	int32 SendEventsNow(const FAptabaseEventBuffer& Events, int32 FirstIndex, uint64 EndCycles, bool bIsCritical = false);
+	/**
+	 * @brief Serializes events starting at FirstIndex into a new batch of about TargetBatchBytes
+	 * @note The batch's NumEvents tells how many events were consumed, its SpoolRefs which journal records they came from
+	 */
+	TSharedRef<FAptabaseEventBatch> EncodeNextBatch(const FAptabaseEventBuffer& Events, int32 FirstIndex);
+	/**
+	 * @brief Queues an encoded batch until a request slot is available
+	 * @note Critical batches are queued behind the other critical ones, ahead of everything else
+	 */
+	void EnqueueBatch(const TSharedRef<FAptabaseEventBatch>& Batch);
+	/**
+	 * @brief Sends queued batches until MaxConcurrentRequests requests are in flight
+	 */
+	void DispatchPendingBatches();
+	/**
+	 * @brief Uploads an already encoded batch
+	 */
+	void SendBatch(const TSharedRef<FAptabaseEventBatch>& Batch);
 	/**
 	 * Internal function for common code in recording events
 	 */
-	void RecordEventInternal(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes);
+	void RecordEventInternal(FAptabaseSessionHandle Session, const FString& EventName, EAptabaseEventPriority Priority, TFunctionRef<void(FAptabaseEventAttributeArray&)> MakeAttributes);
+	/**
+	 * @brief Moves every event recorded since the last drain into BatchedEvents, CriticalEvents or the aggregator, tagging them with the current session snapshot
+	 * @note With a spool, the events are journaled to it on the way
+	 */
+	void DrainIncomingEvents();
+	/**
+	 * @brief Gets the pipeline thread to journal the recorded events within PersistInterval, callable from any thread
+	 */
+	void SchedulePersist();
+	/**
+	 * @brief Drains the recorded events, which journals them to the spool
+	 */
+	bool OnPersistTick(float DeltaTime);
+	/**
+	 * @brief Opens a journal record if none is, and accounts for an event about to be written to it
+	 * @return Spool id of the record the event goes to
+	 */
+	uint64 BeginJournalEvent(const FDateTime& TimeStamp);
+	/**
+	 * @brief Closes the journal record once it is as large as a batch, so every record can be replayed as a single request
+	 */
+	void EndJournalEvent();
+	/**
+	 * @brief Appends the open journal record to the spool
+	 */
+	void WriteJournalRecord();
+	/**
+	 * @brief Callback executed when the transport acknowledged a batch, or failed to deliver it
+	 */
+	void OnEventsRecoded(const FAptabaseTransportResponse& Response, TSharedRef<FAptabaseEventBatch> Batch);
+	/**
+	 * @brief Schedules another attempt for a batch that failed to upload, or discards it once it ran out of attempts
+	 */
+	void RetryOrDiscardBatch(const IAptabaseTransportRequest& Request, const TSharedRef<FAptabaseEventBatch>& Batch, TOptional<double> RetryAfter);
+	/**
+	 * @brief Queues the batch until its NextAttemptTime
+	 */
+	void AddRetryBatch(const TSharedRef<FAptabaseEventBatch>& Batch);
+	/**
+	 * @brief (Re)arms the one-shot ticker for the earliest due retry
+	 */
+	void ScheduleRetryTick();
+	/**
+	 * @brief Sends the batches whose retry delay elapsed
+	 */
+	bool OnRetryTick(float DeltaTime);
+	/**
+	 * @brief Moves the batches whose retry delay elapsed back to PendingBatches and dispatches them
+	 */
+	void SendDueRetryBatches();
+	/**
+	 * @brief Whether the queued events and retry batches exceed the configured budget
+	 */
+	bool IsOverQueueBudget() const;
+	/**
+	 * @brief Gets the pipeline thread to apply the overflow policy, callable from any thread
+	 */
+	void RequestQueueBudgetEnforcement();
+	/**
+	 * @brief Applies the configured overflow policy until the queue is back within its budget
+	 */
+	void EnforceQueueBudget();
+	/**
+	 * @brief Overflow policy: discards events from the front of BatchedEvents
+	 */
+	void DropOldestEvents();
+	/**
+	 * @brief Overflow policy: discards the lowest priority events, oldest first
+	 */
+	void DropLowestPriorityEvents();
+	/**
+	 * @brief Overflow policy: moves the oldest events to the spool, keeping only their spool id in memory
+	 */
+	void SpillOldestEvents();
+	/**
+	 * @brief Makes sure the batch body has a spool record of its own and releases it from memory
+	 * @return false if the body couldn't be written, in which case it is kept
+	 */
+	bool SpillBatch(FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Removes events leaving the queue from the budget
+	 */
+	void ReleaseQueuedEvents(int32 NumEvents, int64 NumBytes);
+	/**
+	 * @brief Adds a batch waiting for a retry to the budget
+	 */
+	void TrackQueuedBatch(const FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Removes a batch that stopped waiting for a retry from the budget
+	 */
+	void ReleaseQueuedBatch(const FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Reports the counters to the stats system and the CSV profiler
+	 */
+	void PublishStats() const;
 	/**
-	 * @brief Callback executed when an event is successfully recoded by the analytics backend.
+	 * @brief Builds the immutable session data shared by all events recorded until the next refresh
 	 */
-	void OnEventsRecoded(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TArray<FAptabaseEventPayload> OriginalEvents);
+	static TSharedRef<const FAptabaseSessionSnapshot> MakeSessionSnapshot(const FString& InSessionId, const FAptabaseSessionProperties& Properties = FAptabaseSessionProperties());
+	/**
+	 * @brief Snapshot of a session started with CreateSession, null if it isn't active
+	 * @note Lock-free, callable from any thread
+	 */
+	TSharedPtr<const FAptabaseSessionSnapshot> FindSession(FAptabaseSessionHandle Session) const;
+	/**
+	 * @brief Publishes an updated copy of the session table and frees the previous one once no thread reads it anymore
+	 */
+	void UpdateSessions(TFunctionRef<void(FSessionMap&)> Update);
 	/**
 	 * @brief Current Id of the user, required by the IAnalyticsProvider interface
 	 * @warning Aptabase is a privacy-first solution and will NOT send the UserId to the backend.
@@ -55,18 +276,188 @@ private:
 	 * @brief Current Id of the user's session
 	 */
 	FString SessionId;
+	/**
+	 * @brief Session id and system properties referenced by every event of the active session
+	 */
+	TSharedPtr<const FAptabaseSessionSnapshot> SessionSnapshot;
+	/**
+	 * @brief Sessions started with CreateSession, by handle id, null while there are none
+	 * @note Events of these sessions are tagged with their snapshot as they are recorded, the others when they are drained.
+	 * Read without a lock by every thread recording events, so a published table is never modified, only replaced.
+	 */
+	std::atomic<const FSessionMap*> Sessions = nullptr;
+	/**
+	 * @brief Readers of Sessions, a replaced table is freed once they are done with it
+	 */
+	FAptabaseReadEpochs SessionsReadEpochs;
+	/**
+	 * @brief Serializes the changes to Sessions and NextSessionHandleId
+	 */
+	FCriticalSection SessionsLock;
+	/**
+	 * @brief Id of the next handle returned by CreateSession
+	 */
+	uint32 NextSessionHandleId = 1;
+	/**
+	 * @brief Hash of SessionId, sampling decisions of the provider's own session derive from it
+	 */
+	std::atomic<uint32> DefaultSessionSeed = 0;
+	/**
+	 * @brief Drops events according to the sampling rules before they are queued
+	 */
+	FAptabaseEventSampler Sampler;
+	/**
+	 * @brief Delegate handle for applying the sampling rules again when the settings change
+	 */
+	FDelegateHandle SamplingRulesChangedHandle;
+	/**
+	 * @brief Interned "sample_weight", added to the events kept by a sampling rule
+	 */
+	const FAptabaseName SampleWeightKey;
+	/**
+	 * @brief Delegate handle for refreshing the system properties when the culture changes
+	 */
+	FDelegateHandle CultureChangedHandle;
 	/**
 	 * @brief Indicates if the user has an active session running.
 	 */
-	bool bHasActiveSession = false;
+	std::atomic<bool> bHasActiveSession = false;
+	/**
+	 * @brief Core ticker flushing the batched events, only armed while events are waiting
+	 * @note Independent of any world, so flushing keeps going while the game is paused and without a game instance
+	 */
+	FTSTicker::FDelegateHandle FlushTickerHandle;
+	/**
+	 * @brief Time FlushTickerHandle fires at, from FPlatformTime::Seconds
+	 */
+	double NextFlushTime = TNumericLimits<double>::Max();
+	/**
+	 * @brief Events recorded since the last flush, used to wake the flush ticker up
+	 */
+	std::atomic<int32> NumUnflushedEvents = 0;
+	/**
+	 * @brief Core ticker journaling the recorded events to the spool, only armed while events are waiting
+	 */
+	FTSTicker::FDelegateHandle PersistTickerHandle;
 	/**
-	 * @brief Timer Delegate handle for the periodically flushing of the batched events.
+	 * @brief Events recorded since the last drain, used to wake the persist ticker up
 	 */
-	FTimerHandle BatchEventTimerHandle;
+	std::atomic<int32> NumUnpersistedEvents = 0;
+	/**
+	 * @brief Events recorded from any thread that haven't been picked up by the pipeline thread yet
+	 * @note Lock-free multi-producer queue, only ever dequeued by DrainIncomingEvents
+	 */
+	TQueue<FAptabaseEventPayload, EQueueMode::Mpsc> IncomingEvents;
 	/**
 	 * @brief Events we recoded but haven't sent to the backend yet. Waiting for next flush.
+	 * @note Only accessed from the pipeline thread
+	 */
+	FAptabaseEventBuffer BatchedEvents;
+	/**
+	 * @brief Critical events waiting for the next flush, which is at most CriticalSendInterval away
+	 * @note Only accessed from the pipeline thread. Out of reach of the overflow policies, they count against the budget all the same.
+	 */
+	FAptabaseEventBuffer CriticalEvents;
+	/**
+	 * @brief Events of the flush in progress, encoded one time slice at a time
+	 * @note Only accessed from the pipeline thread. Already released from the queue budget.
+	 */
+	FAptabaseEventBuffer FlushingEvents;
+	/**
+	 * @brief First event of FlushingEvents left to encode
+	 */
+	int32 NextFlushIndex = 0;
+	/**
+	 * @brief Folds the events configured in AggregatedEvents into summary events as they are drained
+	 */
+	FAptabaseEventAggregator Aggregator;
+	/**
+	 * @brief Encoded batches waiting for a free request slot
+	 * @note Only accessed from the pipeline thread
+	 */
+	TArray<TSharedRef<FAptabaseEventBatch>> PendingBatches;
+	/**
+	 * @brief Number of requests sent and not completed yet
+	 */
+	std::atomic<int32> NumRequestsInFlight = 0;
+	/**
+	 * @brief Request carrying each batch in flight, a completion whose batch isn't in here anymore is ignored
+	 * @note Only accessed from the pipeline thread
+	 */
+	TMap<TSharedRef<FAptabaseEventBatch>, TSharedRef<IAptabaseTransportRequest>> InFlightRequests;
+	/**
+	 * @brief Encoded batches waiting for their next attempt
+	 * @note Only accessed from the pipeline thread
+	 */
+	TArray<TSharedRef<FAptabaseEventBatch>> RetryBatches;
+	/**
+	 * @brief Batches moved to the spool by the SpillToDisk overflow policy, with their bodies released
+	 */
+	TArray<TSharedRef<FAptabaseEventBatch>> SpilledBatches;
+	/**
+	 * @brief Number of events (queued or waiting for a retry) counted against MaxQueuedEvents
+	 */
+	std::atomic<int64> QueuedEvents = 0;
+	/**
+	 * @brief Memory taken by the queued events and retry batches, counted against MaxQueuedBytes
+	 */
+	std::atomic<int64> QueuedBytes = 0;
+	/**
+	 * @brief Number of events discarded because the queue was over its budget or the name table was full
+	 */
+	std::atomic<int64> NumDroppedEvents = 0;
+	/**
+	 * @brief Set while a budget enforcement is scheduled on the pipeline thread
+	 */
+	std::atomic<bool> bQueueBudgetEnforcementRequested = false;
+	/**
+	 * @brief Ticker sending RetryBatches once they are due
+	 */
+	FTSTicker::FDelegateHandle RetryTickerHandle;
+	/**
+	 * @brief Time until which the backend asked us not to send anything (Retry-After), from FPlatformTime::Seconds
+	 */
+	double BackendUnavailableUntil = 0.0;
+	/**
+	 * @brief On-disk copy of the events that haven't been acknowledged by the backend yet
+	 */
+	TUniquePtr<FAptabaseEventSpool> Spool;
+	/**
+	 * @brief Encodes the events journaled to the spool as they are drained, independently of the outgoing batches
+	 */
+	FAptabaseEventSerializer JournalSerializer;
+	/**
+	 * @brief Journal record being filled, its SpoolId is 0 while none is open
+	 */
+	FAptabaseEventBatch JournalRecord;
+	/**
+	 * @brief Totals reported by GetStats
+	 */
+	FAptabaseCounters Counters;
+	/**
+	 * @brief Encodes outgoing batches, reusing its buffers between requests
+	 */
+	FAptabaseEventSerializer Serializer;
+	/**
+	 * @brief Set while DispatchPendingBatches runs, so completions running inline don't dispatch from inside it
+	 */
+	bool bIsDispatchingBatches = false;
+	/**
+	 * @brief Set once the backend refused a compressed body, after which every request is sent uncompressed
+	 */
+	bool bCompressionRejected = false;
+	/**
+	 * @brief Delivers the batches, over HTTP unless another Transport is selected in the settings or one was passed in
+	 */
+	TUniquePtr<IAptabaseTransport> Transport;
+	/**
+	 * @brief Thread running the pipeline when bUseBackgroundWorker is enabled, null when it runs on the game thread
+	 */
+	TUniquePtr<FAptabaseWorker> Worker;
+	/**
+	 * @brief Persistence hook for the batches a drain couldn't deliver
 	 */
-	TArray<FAptabaseEventPayload> BatchedEvents;
+	FOnAptabaseUnsentBatch UnsentBatchDelegate;
 	/**
 	 * @brief Default event attributes that will be added to all events
 	 */
@@ -0,0 +1,434 @@
+#include <HAL/IConsoleManager.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
+#include <Policies/CondensedJsonPrintPolicy.h>
+#include <Serialization/JsonSerializer.h>
+#include <Serialization/JsonWriter.h>
+#include <Templates/UnrealTemplate.h>
+
+#include "AptabaseAllocationCounter.h"
+#include "AptabaseAnalyticsProvider.h"
+#include "AptabaseData.h"
+#include "AptabaseEventSerializer.h"
+#include "AptabaseLog.h"
+#include "AptabaseNameTable.h"
+#include "AptabaseSettings.h"
+#include "ExtendedAnalyticsEventAttribute.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace
+{
+	// Each case runs at least this long so timer resolution and warm-up don't dominate the result
+	constexpr double MinCaseDuration = 0.5;
+
+	// Same size as a full request
+	constexpr int32 NumEventsPerBatch = 25;
+
+	// Record calls are timed in rounds of this many, the events are delivered untimed in between so the queue doesn't grow
+	constexpr int32 NumCallsPerRound = 10000;
+
+	// Events queued before each timed FlushEvents
+	constexpr int32 FlushQueueSizes[] = {1000, 10000, 100000};
+
+	// Timed flushes per queue size, each one needs its events recorded first
+	constexpr int32 NumFlushRounds = 10;
+
+	// Events per end-to-end round, enough that the drain's poll interval stays small next to the work
+	constexpr int32 NumEndToEndEvents = 100000;
+
+	// Attributes of the events recorded by the flush and end-to-end cases
+	constexpr int32 NumPipelineAttributes = 4;
+
+	// Long enough for the biggest flush to be acknowledged by the loopback transport
+	constexpr double DeliveryTimeout = 10.0;
+
+	struct FBenchmarkResult
+	{
+		FString Name;
+		int32 NumAttributes = 0;
+		int32 NumQueuedEvents = 0;
+		double NanosecondsPerEvent = 0.0;
+		double MegabytesPerSecond = 0.0;
+		double AllocationsPerEvent = 0.0;
+	};
+
+	template <typename FunctionType>
+	double MeasureSecondsPerIteration(FunctionType&& Function)
+	{
+		// Warm-up, so buffers and caches reused between iterations are already in place
+		Function();
+
+		int64 NumIterations = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		double ElapsedTime = 0.0;
+		do
+		{
+			Function();
+			++NumIterations;
+			ElapsedTime = FPlatformTime::Seconds() - StartTime;
+		}
+		while (ElapsedTime < MinCaseDuration);
+
+		return ElapsedTime / NumIterations;
+	}
+
+	template <typename FunctionType>
+	double CountAllocationsPerEvent(int32 NumEvents, FunctionType&& Function)
+	{
+		FAptabaseAllocationCounter AllocationCounter;
+		Function();
+		return static_cast<double>(AllocationCounter.GetNumAllocations()) / NumEvents;
+	}
+
+	TArray<FAptabaseEventPayload> MakeEvents(int32 NumAttributes)
+	{
+		const TSharedRef<FAptabaseSessionSnapshot> Session = MakeShared<FAptabaseSessionSnapshot>();
+		Session->SessionId = TEXT("172800000012345678");
+		Session->SystemProps.Locale = TEXT("en-US");
+		Session->SystemProps.AppVersion = TEXT("1.0.0");
+		Session->SystemProps.SdkVersion = TEXT("aptabase-unreal@benchmark");
+		Session->SystemProps.OsName = TEXT("Linux");
+		Session->SystemProps.OsVersion = TEXT("6.0");
+
+		FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+		TArray<FAptabaseEventPayload> Events;
+		for (int32 EventIndex = 0; EventIndex < NumEventsPerBatch; ++EventIndex)
+		{
+			FAptabaseEventPayload& Event = Events.AddDefaulted_GetRef();
+			Event.TimeStamp = FDateTime::UtcNow();
+			Event.EventName = NameTable.Intern(TEXT("benchmark_event"));
+			Event.Session = Session;
+
+			// Half strings, half numbers, which is about what games send
+			for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes; ++AttributeIndex)
+			{
+				FAptabaseEventAttribute& Attribute = Event.EventAttributes.AddDefaulted_GetRef();
+				Attribute.Key = NameTable.Intern(FString::Printf(TEXT("attribute_%d"), AttributeIndex));
+				if (AttributeIndex % 2 == 0)
+				{
+					Attribute.Value.Set<FString>(FString::Printf(TEXT("value_%d_%d"), EventIndex, AttributeIndex));
+				}
+				else
+				{
+					Attribute.Value.Set<double>(EventIndex * 1000.0 + AttributeIndex + 0.5);
+				}
+			}
+		}
+
+		return Events;
+	}
+
+	TArray<FAnalyticsEventAttribute> MakeAttributes(int32 NumAttributes)
+	{
+		TArray<FAnalyticsEventAttribute> Attributes;
+		for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes; ++AttributeIndex)
+		{
+			const FString Key = FString::Printf(TEXT("attribute_%d"), AttributeIndex);
+			if (AttributeIndex % 2 == 0)
+			{
+				Attributes.Emplace(Key, FString::Printf(TEXT("value_%d"), AttributeIndex));
+			}
+			else
+			{
+				Attributes.Emplace(Key, AttributeIndex + 0.5);
+			}
+		}
+
+		return Attributes;
+	}
+
+	TArray<FExtendedAnalyticsEventAttribute> MakeExtendedAttributes(int32 NumAttributes)
+	{
+		TArray<FExtendedAnalyticsEventAttribute> Attributes;
+		for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes; ++AttributeIndex)
+		{
+			FExtendedAnalyticsEventAttribute& Attribute = Attributes.AddDefaulted_GetRef();
+			Attribute.Key = FString::Printf(TEXT("attribute_%d"), AttributeIndex);
+			if (AttributeIndex % 2 == 0)
+			{
+				Attribute.Value.Set<FString>(FString::Printf(TEXT("value_%d"), AttributeIndex));
+			}
+			else
+			{
+				Attribute.Value.Set<double>(AttributeIndex + 0.5);
+			}
+		}
+
+		return Attributes;
+	}
+
+	void DeliverQueuedEvents(IAptabaseAnalytics& Provider)
+	{
+		Provider.FlushEvents();
+		Provider.Drain(DeliveryTimeout);
+	}
+
+	template <typename FunctionType>
+	FBenchmarkResult MeasureRecordCalls(const TCHAR* Name, int32 NumAttributes, IAptabaseAnalytics& Provider, FunctionType&& Function)
+	{
+		const auto RunRound = [&Function]()
+		{
+			for (int32 CallIndex = 0; CallIndex < NumCallsPerRound; ++CallIndex)
+			{
+				Function();
+			}
+		};
+
+		// Warm-up, so the name table and the queues already hold what the timed rounds need
+		RunRound();
+		DeliverQueuedEvents(Provider);
+
+		int64 NumCalls = 0;
+		double ElapsedTime = 0.0;
+		do
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			RunRound();
+			ElapsedTime += FPlatformTime::Seconds() - StartTime;
+			NumCalls += NumCallsPerRound;
+
+			DeliverQueuedEvents(Provider);
+		}
+		while (ElapsedTime < MinCaseDuration);
+
+		// Counted in a round of its own, the proxy allocator would otherwise add to the timings
+		const double AllocationsPerCall = CountAllocationsPerEvent(NumCallsPerRound, RunRound);
+		DeliverQueuedEvents(Provider);
+
+		return {Name, NumAttributes, 0, ElapsedTime * 1e9 / NumCalls, 0.0, AllocationsPerCall};
+	}
+
+	FBenchmarkResult MeasureFlush(int32 NumQueuedEvents, IAptabaseAnalytics& Provider)
+	{
+		const FString EventName = TEXT("benchmark_event");
+		const TArray<FExtendedAnalyticsEventAttribute> Attributes = MakeExtendedAttributes(NumPipelineAttributes);
+		const auto RecordEvents = [NumQueuedEvents, &Provider, &EventName, &Attributes]()
+		{
+			for (int32 EventIndex = 0; EventIndex < NumQueuedEvents; ++EventIndex)
+			{
+				Provider.RecordExtendedEvent(EventName, Attributes);
+			}
+		};
+
+		RecordEvents();
+		DeliverQueuedEvents(Provider);
+
+		// Only FlushEvents is timed: draining the ingest queue, encoding the batches and handing them to the transport
+		double ElapsedTime = 0.0;
+		int64 NumBytes = 0;
+		for (int32 Round = 0; Round < NumFlushRounds; ++Round)
+		{
+			RecordEvents();
+
+			const int64 BytesBefore = Provider.GetStats().BytesBeforeCompression;
+			const double StartTime = FPlatformTime::Seconds();
+			Provider.FlushEvents();
+			ElapsedTime += FPlatformTime::Seconds() - StartTime;
+			NumBytes += Provider.GetStats().BytesBeforeCompression - BytesBefore;
+
+			Provider.Drain(DeliveryTimeout);
+		}
+
+		RecordEvents();
+		const double AllocationsPerEvent = CountAllocationsPerEvent(NumQueuedEvents, [&Provider]()
+		{
+			Provider.FlushEvents();
+		});
+		Provider.Drain(DeliveryTimeout);
+
+		const int64 NumEvents = static_cast<int64>(NumQueuedEvents) * NumFlushRounds;
+		return {TEXT("FlushEvents"), NumPipelineAttributes, NumQueuedEvents, ElapsedTime * 1e9 / NumEvents, NumBytes / ElapsedTime / (1024.0 * 1024.0), AllocationsPerEvent};
+	}
+
+	FBenchmarkResult MeasureEndToEnd(IAptabaseAnalytics& Provider)
+	{
+		const FString EventName = TEXT("benchmark_event");
+		const TArray<FExtendedAnalyticsEventAttribute> Attributes = MakeExtendedAttributes(NumPipelineAttributes);
+
+		// Recording, flushing and every acknowledgment are timed, until the last event is delivered
+		int64 NumEvents = 0;
+		int64 NumBytes = 0;
+		double ElapsedTime = 0.0;
+		do
+		{
+			const FAptabaseStats StatsBefore = Provider.GetStats();
+			const double StartTime = FPlatformTime::Seconds();
+
+			for (int32 EventIndex = 0; EventIndex < NumEndToEndEvents; ++EventIndex)
+			{
+				Provider.RecordExtendedEvent(EventName, Attributes);
+			}
+			DeliverQueuedEvents(Provider);
+
+			ElapsedTime += FPlatformTime::Seconds() - StartTime;
+
+			const FAptabaseStats StatsAfter = Provider.GetStats();
+			const int64 NumSentEvents = StatsAfter.EventsSent - StatsBefore.EventsSent;
+			if (NumSentEvents != NumEndToEndEvents)
+			{
+				UE_LOG(LogAptabase, Warning, TEXT("Only %lld of %d events were delivered within %.0f seconds."), NumSentEvents, NumEndToEndEvents, DeliveryTimeout);
+			}
+
+			NumEvents += NumSentEvents;
+			NumBytes += StatsAfter.BytesUploaded - StatsBefore.BytesUploaded;
+		}
+		while (ElapsedTime < MinCaseDuration);
+
+		return {TEXT("Loopback"), NumPipelineAttributes, NumEndToEndEvents, ElapsedTime * 1e9 / FMath::Max<int64>(NumEvents, 1), NumBytes / ElapsedTime / (1024.0 * 1024.0), 0.0};
+	}
+
+	void RunProviderBenchmarks(TArray<FBenchmarkResult>& Results)
+	{
+		// A provider of its own on the game thread, delivering instantly through the loopback transport with nothing
+		// persisted, sliced or held back by the budgets. The game's provider sees these settings too while they apply.
+		UAptabaseSettings* Settings = GetMutableDefault<UAptabaseSettings>();
+		TGuardValue<EAptabaseTransport> TransportGuard(Settings->Transport, EAptabaseTransport::Loopback);
+		TGuardValue<float> LoopbackLatencyGuard(Settings->LoopbackLatency, 0.0f);
+		TGuardValue<float> LoopbackFailureRateGuard(Settings->LoopbackFailureRate, 0.0f);
+		TGuardValue<float> LoopbackErrorRateGuard(Settings->LoopbackErrorRate, 0.0f);
+		TGuardValue<bool> CompressRequestsGuard(Settings->bCompressRequests, false);
+		TGuardValue<bool> PersistEventsGuard(Settings->bPersistEvents, false);
+		TGuardValue<bool> UseBackgroundWorkerGuard(Settings->bUseBackgroundWorker, false);
+		TGuardValue<float> FlushTimeBudgetGuard(Settings->FlushTimeBudgetMs, 0.0f);
+		TGuardValue<int32> MaxConcurrentRequestsGuard(Settings->MaxConcurrentRequests, MAX_int32);
+		TGuardValue<int32> MaxQueuedEventsGuard(Settings->MaxQueuedEvents, MAX_int32);
+		TGuardValue<int32> MaxQueuedBytesGuard(Settings->MaxQueuedBytes, MAX_int32);
+
+		const TSharedRef<IAptabaseAnalytics> Provider = MakeShared<FAptabaseAnalyticsProvider>();
+		Provider->StartSession(TArray<FAnalyticsEventAttribute>());
+
+		const FString EventName = TEXT("benchmark_event");
+		for (const int32 NumAttributes : {0, 4, 16})
+		{
+			const TArray<FAnalyticsEventAttribute> Attributes = MakeAttributes(NumAttributes);
+			Results.Add(MeasureRecordCalls(TEXT("RecordEvent"), NumAttributes, *Provider, [&Provider, &EventName, &Attributes]()
+			{
+				Provider->RecordEvent(EventName, Attributes);
+			}));
+
+			const TArray<FExtendedAnalyticsEventAttribute> ExtendedAttributes = MakeExtendedAttributes(NumAttributes);
+			Results.Add(MeasureRecordCalls(TEXT("RecordExtendedEvent"), NumAttributes, *Provider, [&Provider, &EventName, &ExtendedAttributes]()
+			{
+				Provider->RecordExtendedEvent(EventName, ExtendedAttributes);
+			}));
+		}
+
+		for (const int32 NumQueuedEvents : FlushQueueSizes)
+		{
+			Results.Add(MeasureFlush(NumQueuedEvents, *Provider));
+		}
+
+		Results.Add(MeasureEndToEnd(*Provider));
+
+		Provider->EndSession();
+		Provider->Drain(DeliveryTimeout);
+	}
+
+	void RunBenchmarks(const TArray<FString>& Args)
+	{
+		TArray<FBenchmarkResult> Results;
+
+		for (const int32 NumAttributes : {0, 4, 16})
+		{
+			const TArray<FAptabaseEventPayload> Events = MakeEvents(NumAttributes);
+
+			FAptabaseEventSerializer Serializer;
+			int32 NumSerializedBytes = 0;
+			const double SerializeSeconds = MeasureSecondsPerIteration([&Serializer, &Events, &NumSerializedBytes]()
+			{
+				NumSerializedBytes = Serializer.SerializeBatch(Events).Num();
+			});
+			const double SerializeAllocations = CountAllocationsPerEvent(Events.Num(), [&Serializer, &Events]()
+			{
+				Serializer.SerializeBatch(Events);
+			});
+			Results.Add({TEXT("SerializeBatch"), NumAttributes, 0, SerializeSeconds * 1e9 / Events.Num(), NumSerializedBytes / SerializeSeconds / (1024.0 * 1024.0), SerializeAllocations});
+
+			// Reference path: FJsonObject DOM, condensed TJsonWriter and UTF-8 conversion
+			int32 NumDomBytes = 0;
+			const auto SerializeDom = [&Events, &NumDomBytes]()
+			{
+				TArray<TSharedPtr<FJsonValue>> Values;
+				for (const FAptabaseEventPayload& Event : Events)
+				{
+					Values.Add(MakeShared<FJsonValueObject>(Event.ToJsonObject()));
+				}
+
+				FString Json;
+				const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+				FJsonSerializer::Serialize(Values, Writer);
+
+				const FTCHARToUTF8 Utf8Json(*Json);
+				NumDomBytes = Utf8Json.Length();
+			};
+			const double DomSeconds = MeasureSecondsPerIteration(SerializeDom);
+			const double DomAllocations = CountAllocationsPerEvent(Events.Num(), SerializeDom);
+			Results.Add({TEXT("ToJsonObject"), NumAttributes, 0, DomSeconds * 1e9 / Events.Num(), NumDomBytes / DomSeconds / (1024.0 * 1024.0), DomAllocations});
+
+			// What recording an event costs on the calling thread for its name and keys
+			const FString EventName = TEXT("benchmark_event");
+			TArray<FString> Keys;
+			for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes; ++AttributeIndex)
+			{
+				Keys.Add(FString::Printf(TEXT("attribute_%d"), AttributeIndex));
+			}
+
+			const auto InternNames = [&EventName, &Keys]()
+			{
+				FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+				NameTable.Intern(EventName);
+				for (const FString& Key : Keys)
+				{
+					NameTable.Intern(Key);
+				}
+			};
+			const double InternSeconds = MeasureSecondsPerIteration(InternNames);
+			Results.Add({TEXT("InternNames"), NumAttributes, 0, InternSeconds * 1e9, 0.0, CountAllocationsPerEvent(1, InternNames)});
+		}
+
+		RunProviderBenchmarks(Results);
+
+		FString Output;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("platform"), FString(FPlatformProperties::IniPlatformName()));
+		Writer->WriteValue(TEXT("timeStamp"), FDateTime::UtcNow().ToIso8601());
+		Writer->WriteArrayStart(TEXT("results"));
+		for (const FBenchmarkResult& Result : Results)
+		{
+			UE_LOG(LogAptabase, Display, TEXT("%-20s %2d attributes %6d queued: %10.1f ns/event %8.2f allocations/event %10.1f MB/s"), *Result.Name, Result.NumAttributes, Result.NumQueuedEvents, Result.NanosecondsPerEvent, Result.AllocationsPerEvent, Result.MegabytesPerSecond);
+
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("name"), Result.Name);
+			Writer->WriteValue(TEXT("numAttributes"), Result.NumAttributes);
+			Writer->WriteValue(TEXT("numQueuedEvents"), Result.NumQueuedEvents);
+			Writer->WriteValue(TEXT("nanosecondsPerEvent"), Result.NanosecondsPerEvent);
+			Writer->WriteValue(TEXT("allocationsPerEvent"), Result.AllocationsPerEvent);
+			Writer->WriteValue(TEXT("megabytesPerSecond"), Result.MegabytesPerSecond);
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+		Writer->Close();
+
+		const FString OutputPath = Args.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Aptabase"), TEXT("Benchmark.json")) : Args[0];
+		if (FFileHelper::SaveStringToFile(Output, *OutputPath))
+		{
+			UE_LOG(LogAptabase, Display, TEXT("Benchmark results written to %s"), *OutputPath);
+		}
+		else
+		{
+			UE_LOG(LogAptabase, Error, TEXT("Failed to write benchmark results to %s"), *OutputPath);
+		}
+	}
+
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("Aptabase.Benchmark"),
+		TEXT("Measures the cost of recording, encoding, flushing and delivering events and writes the results as JSON. Usage: Aptabase.Benchmark [OutputFile]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunBenchmarks));
+} // namespace
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <HAL/PlatformTime.h>
+#include <Stats/Stats.h>
+
+#include <atomic>
+
+#include "AptabaseStats.h"
+
+DECLARE_STATS_GROUP(TEXT("Aptabase"), STATGROUP_Aptabase, STATCAT_Advanced);
+
+/**
+ * @brief Running totals behind FAptabaseStats
+ * @note Lock-free, updated from whichever thread records, flushes or completes requests
+ */
+struct FAptabaseCounters
+{
+	std::atomic<int64> EventsRecorded = 0;
+	std::atomic<int64> EventsSent = 0;
+	std::atomic<int64> EventsDiscarded = 0;
+	std::atomic<int64> EventsRetried = 0;
+	std::atomic<int64> EventsSampledOut = 0;
+	std::atomic<int64> EventsRateLimited = 0;
+	std::atomic<int64> BytesUploaded = 0;
+	std::atomic<int64> BytesBeforeCompression = 0;
+	std::atomic<int64> RequestLatencyHistogram[FAptabaseStats::NumLatencyBuckets] = {};
+	std::atomic<uint64> RecordCycles = 0;
+	std::atomic<uint64> FlushCycles = 0;
+	std::atomic<uint64> LastFlushCycles = 0;
+	std::atomic<uint64> MaxFlushCycles = 0;
+	std::atomic<int64> FlushSlices = 0;
+
+	/**
+	 * @brief Counts a completed request in its latency bucket
+	 */
+	void AddRequestLatency(double Seconds)
+	{
+		const double Milliseconds = Seconds * 1000.0;
+
+		int32 Bucket = 0;
+		while (Bucket < UE_ARRAY_COUNT(FAptabaseStats::LatencyBucketUpperBounds) && Milliseconds > FAptabaseStats::LatencyBucketUpperBounds[Bucket])
+		{
+			++Bucket;
+		}
+
+		++RequestLatencyHistogram[Bucket];
+	}
+};
+
+/**
+ * @brief Adds the time spent in its scope to a cycle counter
+ */
+class FAptabaseScopedCycleCounter
+{
+public:
+	explicit FAptabaseScopedCycleCounter(std::atomic<uint64>& InCycles)
+		: Cycles(InCycles)
+		, StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~FAptabaseScopedCycleCounter()
+	{
+		Cycles += FPlatformTime::Cycles64() - StartCycles;
+	}
+
+	/**
+	 * @brief Cycles spent so far in the scope
+	 */
+	uint64 GetElapsedCycles() const { return FPlatformTime::Cycles64() - StartCycles; }
+
+private:
+	std::atomic<uint64>& Cycles;
+	const uint64 StartCycles;
+};
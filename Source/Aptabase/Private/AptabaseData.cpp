@@ -2,30 +2,53 @@
 
 #include <JsonObjectConverter.h>
 
+#include "AptabaseEventBuffer.h"
+
 TSharedPtr<FJsonObject> FAptabaseEventPayload::ToJsonObject() const
 {
+	const FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
 	const TSharedPtr<FJsonObject> Props = MakeShared<FJsonObject>();
 
-	for (const FExtendedAnalyticsEventAttribute& Attribute : EventAttributes)
+	for (const FAptabaseEventAttribute& Attribute : EventAttributes)
 	{
+		const FString& Key = NameTable.Resolve(Attribute.Key).String;
 		const auto& AttributeValue = Attribute.Value;
 
 		if (AttributeValue.IsType<double>())
 		{
-			Props->SetField(Attribute.Key, MakeShared<FJsonValueNumber>(AttributeValue.Get<double>()));
+			Props->SetField(Key, MakeShared<FJsonValueNumber>(AttributeValue.Get<double>()));
 		}
 		else if (AttributeValue.IsType<float>())
 		{
-			Props->SetField(Attribute.Key, MakeShared<FJsonValueNumber>(AttributeValue.Get<float>()));
+			Props->SetField(Key, MakeShared<FJsonValueNumber>(AttributeValue.Get<float>()));
+		}
+		else if (AttributeValue.IsType<int64>())
+		{
+			// A double would round integers above 2^53
+			Props->SetField(Key, MakeShared<FJsonValueNumberString>(LexToString(AttributeValue.Get<int64>())));
+		}
+		else if (AttributeValue.IsType<bool>())
+		{
+			Props->SetField(Key, MakeShared<FJsonValueBoolean>(AttributeValue.Get<bool>()));
 		}
 		else
 		{
-			Props->SetField(Attribute.Key, MakeShared<FJsonValueString>(AttributeValue.Get<FString>()));
+			Props->SetField(Key, MakeShared<FJsonValueString>(AttributeValue.Get<FString>()));
 		}
 	}
 
-	const TSharedPtr<FJsonObject> Payload = FJsonObjectConverter::UStructToJsonObject(*this);
+	// Field names and order match what FJsonObjectConverter produced when the session data lived on the payload itself
+	const TSharedPtr<FJsonObject> Payload = MakeShared<FJsonObject>();
+	Payload->SetStringField(TEXT("timeStamp"), TimeStamp.ToIso8601());
+	Payload->SetStringField(TEXT("sessionId"), Session->SessionId);
+	Payload->SetStringField(TEXT("eventName"), NameTable.Resolve(EventName).String);
+	Payload->SetObjectField(TEXT("systemProps"), FJsonObjectConverter::UStructToJsonObject(Session->SystemProps));
 	Payload->SetObjectField("props", Props);
 
 	return Payload;
-}
\ No newline at end of file
+}
+
+SIZE_T FAptabaseEventPayload::GetAllocatedSize() const
+{
+	return FAptabaseEventBuffer::GetEventSize(EventAttributes);
+}
@@ -1,6 +1,12 @@
 ﻿#pragma once
 
-#include "ExtendedAnalyticsEventAttribute.h"
+#include <Experimental/ConcurrentLinearAllocator.h>
+#include <Misc/DateTime.h>
+#include <Misc/TVariant.h>
+
+#include "AptabaseEventPriority.h"
+#include "AptabaseNameTable.h"
+#include "AptabaseSession.h"
 
 #include "AptabaseData.generated.h"
 
@@ -53,6 +59,107 @@ struct FAptabaseSystemProperties
 	FString OsVersion;
 };
 
+/**
+ * @brief Immutable per-session data shared by every event recorded during that session
+ * @note Captured once when the session starts and replaced (never mutated) when it needs refreshing
+ */
+struct FAptabaseSessionSnapshot
+{
+	/**
+	 * @brief Id of the session the events belong to
+	 */
+	FString SessionId;
+
+	/**
+	 * @brief Information about the user's system
+	 */
+	FAptabaseSystemProperties SystemProps;
+
+	/**
+	 * @brief Overrides the session was created with, applied again whenever the snapshot is refreshed
+	 */
+	FAptabaseSessionProperties Properties;
+};
+
+/**
+ * @brief Block allocation tag for the attributes of queued events
+ * @note Attributes of events recorded together share the same blocks, which go back to the allocator as soon as their events are sent
+ */
+struct FAptabaseEventBlockAllocationTag : FDefaultBlockAllocationTag
+{
+	static constexpr const char* TagName = "AptabaseEvents";
+};
+
+/**
+ * @brief Event attribute as queued by the provider, with its key interned
+ */
+struct FAptabaseEventAttribute
+{
+	/**
+	 * @brief Name of the attribute
+	 */
+	FAptabaseName Key;
+
+	/**
+	 * @brief Value of the attribute, same types as FExtendedAnalyticsEventAttribute
+	 */
+	TVariant<FString, float, double, int64, bool> Value;
+};
+
+using FAptabaseEventAttributeArray = TArray<FAptabaseEventAttribute, TConcurrentLinearArrayAllocator<FAptabaseEventBlockAllocationTag>>;
+
+/**
+ * @brief Spool records holding a set of events, with how many of those events each record holds
+ * @note A record is acknowledged once all of its events were released, events of a batch usually come from one or two records
+ */
+struct FAptabaseSpoolRefs
+{
+	/**
+	 * @brief Spool id and number of events of each record
+	 */
+	TArray<TPair<uint64, int32>, TInlineAllocator<2>> Records;
+
+	/**
+	 * @brief Counts NumEvents more events of the record, ignored for events that aren't in the spool (id 0)
+	 */
+	void Add(uint64 SpoolId, int32 NumEvents = 1)
+	{
+		if (SpoolId == 0)
+		{
+			return;
+		}
+
+		// Events are mostly visited in the order they were journaled, so the last record is the likely match
+		if (!Records.IsEmpty() && Records.Last().Key == SpoolId)
+		{
+			Records.Last().Value += NumEvents;
+			return;
+		}
+
+		if (TPair<uint64, int32>* Record = Records.FindByPredicate([SpoolId](const TPair<uint64, int32>& Candidate) { return Candidate.Key == SpoolId; }))
+		{
+			Record->Value += NumEvents;
+			return;
+		}
+
+		Records.Emplace(SpoolId, NumEvents);
+	}
+
+	/**
+	 * @brief Counts the events of the other set too
+	 */
+	void Append(const FAptabaseSpoolRefs& Other)
+	{
+		for (const TPair<uint64, int32>& Record : Other.Records)
+		{
+			Add(Record.Key, Record.Value);
+		}
+	}
+
+	bool IsEmpty() const { return Records.IsEmpty(); }
+	void Reset() { Records.Reset(); }
+};
+
 /**
  * @brief Payload for HTTP requests to record an event
  */
@@ -62,36 +169,109 @@ struct FAptabaseEventPayload
 	GENERATED_BODY()
 
 	/**
-	 * @brief Time the event happened
+	 * @brief Time the event happened (UTC), formatted as ISO 8601 when the event is serialized
 	 */
 	UPROPERTY()
-	FString TimeStamp;
+	FDateTime TimeStamp;
 
 	/**
-	 * @brief Id of the current session
+	 * @brief Name of the event
 	 */
-	UPROPERTY()
-	FString SessionId;
+	FAptabaseName EventName;
 
 	/**
-	 * @brief Name of the event
+	 * @brief Session id and system properties, shared with every other event of the same session
 	 */
-	UPROPERTY()
-	FString EventName;
+	TSharedPtr<const FAptabaseSessionSnapshot> Session;
 
 	/**
-	 * @brief Information about the user's system
+	 * @brief Additional Event attributes to be sent along-side the main properties
 	 */
-	UPROPERTY()
-	FAptabaseSystemProperties SystemProps;
+	FAptabaseEventAttributeArray EventAttributes;
 
 	/**
-	 * @brief Additional Event attributes to be sent along-side the main properties
+	 * @brief Importance of the event when the queue overflows
+	 */
+	EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal;
+
+	/**
+	 * @brief Spool record the event was journaled to when it was drained, 0 when it isn't persisted
+	 */
+	uint64 SpoolId = 0;
+
+	/**
+	 * @brief Approximate memory held by the event once queued in an FAptabaseEventBuffer, used for the queue budget
 	 */
-	TArray<FExtendedAnalyticsEventAttribute> EventAttributes;
+	SIZE_T GetAllocatedSize() const;
 
 	/**
 	 * @brief Converts the current data to a JSON payload for the backend HTTP requests
+	 * @note Requests are encoded by FAptabaseEventSerializer, this DOM form is kept as its reference output
 	 */
 	TSharedPtr<FJsonObject> ToJsonObject() const;
 };
+
+/**
+ * @brief Batch of events encoded and ready to be uploaded to the backend
+ */
+struct FAptabaseEventBatch
+{
+	/**
+	 * @brief Id of the spool record holding this exact body, 0 when the events were encoded from the journal records below
+	 * @note Only batches with a record of their own can release their body and read it back later
+	 */
+	uint64 SpoolId = 0;
+
+	/**
+	 * @brief Spool records holding the events of the batch, released once the batch is delivered or discarded
+	 */
+	FAptabaseSpoolRefs SpoolRefs;
+
+	/**
+	 * @brief Number of events encoded in the body
+	 */
+	int32 NumEvents = 0;
+
+	/**
+	 * @brief Uncompressed JSON array of events, as sent to the backend
+	 */
+	TArray<uint8> Body;
+
+	/**
+	 * @brief Gzip compressed Body, encoded on the first attempt and reused by the retries
+	 */
+	TArray<uint8> CompressedBody;
+
+	/**
+	 * @brief How many times the batch has been sent so far
+	 */
+	int32 NumAttempts = 0;
+
+	/**
+	 * @brief Time the oldest event of the batch happened (UTC), stored with the spool record so the age survives a restart
+	 */
+	FDateTime OldestEventTime = FDateTime::UtcNow();
+
+	/**
+	 * @brief When the batch was last sent, from FPlatformTime::Seconds
+	 */
+	double LastAttemptTime = 0.0;
+
+	/**
+	 * @brief Earliest time the batch may be sent again, from FPlatformTime::Seconds
+	 */
+	double NextAttemptTime = 0.0;
+
+	/**
+	 * @brief Whether the batch carries Critical events, which go ahead of the other batches and aren't dropped to make room
+	 */
+	bool bIsCritical = false;
+
+	/**
+	 * @brief Memory held by the batch, used for the queue budget while it waits for a retry
+	 */
+	SIZE_T GetAllocatedSize() const
+	{
+		return sizeof(*this) + Body.GetAllocatedSize() + CompressedBody.GetAllocatedSize();
+	}
+};
@@ -0,0 +1,243 @@
+#include "AptabaseEventAggregator.h"
+
+#include "AptabaseEventBuffer.h"
+#include "AptabaseSettings.h"
+
+namespace
+{
+	bool IsNumeric(const FAptabaseEventAttribute& Attribute)
+	{
+		return Attribute.Value.IsType<double>() || Attribute.Value.IsType<float>() || Attribute.Value.IsType<int64>();
+	}
+
+	double GetNumericValue(const FAptabaseEventAttribute& Attribute)
+	{
+		if (Attribute.Value.IsType<int64>())
+		{
+			return static_cast<double>(Attribute.Value.Get<int64>());
+		}
+
+		return Attribute.Value.IsType<double>() ? Attribute.Value.Get<double>() : Attribute.Value.Get<float>();
+	}
+
+	bool HasSameValue(const FAptabaseEventAttribute& A, const FAptabaseEventAttribute& B)
+	{
+		// Booleans stay apart from the strings "true" and "false"
+		if (A.Value.IsType<bool>() || B.Value.IsType<bool>())
+		{
+			return A.Value.IsType<bool>() && B.Value.IsType<bool>() && A.Value.Get<bool>() == B.Value.Get<bool>();
+		}
+
+		return A.Value.Get<FString>().Equals(B.Value.Get<FString>(), ESearchCase::CaseSensitive);
+	}
+
+	void AddNumericAttribute(FAptabaseEventAttributeArray& Attributes, FAptabaseName Key, double Value)
+	{
+		// The name table is full, the summary goes without this attribute rather than sending it with an empty key
+		if (!Key.IsValid())
+		{
+			return;
+		}
+
+		FAptabaseEventAttribute& Attribute = Attributes.Emplace_GetRef();
+		Attribute.Key = Key;
+		Attribute.Value.Set<double>(Value);
+	}
+
+	// Appended to the empty name for the count, and to the attribute key for the other summary attributes
+	const TCHAR* const CountSuffix = TEXT("count");
+	const TCHAR* const SumSuffix = TEXT("_sum");
+	const TCHAR* const MinSuffix = TEXT("_min");
+	const TCHAR* const MaxSuffix = TEXT("_max");
+} // namespace
+
+void FAptabaseEventAggregator::Configure(TConstArrayView<FAptabaseAggregationRule> Rules)
+{
+	FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+	WindowByEventName.Reset();
+	for (const FAptabaseAggregationRule& Rule : Rules)
+	{
+		if (Rule.EventName.IsEmpty())
+		{
+			continue;
+		}
+
+		// A name that doesn't fit in the name table can't be recorded either, so there's nothing to aggregate
+		const FAptabaseName EventName = NameTable.Intern(Rule.EventName);
+		if (EventName.IsValid())
+		{
+			WindowByEventName.Add(EventName, Rule.Window);
+		}
+	}
+}
+
+bool FAptabaseEventAggregator::Add(const FAptabaseEventPayload& Event, double Now)
+{
+	const double* Window = WindowByEventName.Find(Event.EventName);
+	if (!Window)
+	{
+		return false;
+	}
+
+	TArray<const FAptabaseEventAttribute*, TInlineAllocator<8>> StringAttributes;
+	for (const FAptabaseEventAttribute& Attribute : Event.EventAttributes)
+	{
+		if (!IsNumeric(Attribute))
+		{
+			StringAttributes.Add(&Attribute);
+		}
+	}
+
+	// Attribute order doesn't matter for grouping, both sides are compared sorted by key
+	StringAttributes.Sort([](const FAptabaseEventAttribute& A, const FAptabaseEventAttribute& B)
+	{
+		return A.Key.Index < B.Key.Index;
+	});
+
+	// Only a handful of string attribute combinations are expected per event, so they are told apart by a linear search
+	TArray<FGroup>& NameGroups = Groups.FindOrAdd({Event.EventName, Event.Session.Get()});
+	FGroup* Group = NameGroups.FindByPredicate([&StringAttributes](const FGroup& Candidate)
+	{
+		const FAptabaseEventAttributeArray& CandidateAttributes = Candidate.Summary.EventAttributes;
+		if (CandidateAttributes.Num() != StringAttributes.Num())
+		{
+			return false;
+		}
+
+		for (int32 AttributeIndex = 0; AttributeIndex < StringAttributes.Num(); ++AttributeIndex)
+		{
+			if (CandidateAttributes[AttributeIndex].Key != StringAttributes[AttributeIndex]->Key || !HasSameValue(CandidateAttributes[AttributeIndex], *StringAttributes[AttributeIndex]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	});
+
+	if (!Group)
+	{
+		Group = &NameGroups.AddDefaulted_GetRef();
+		Group->WindowEnd = Now + *Window;
+		Group->Summary.TimeStamp = Event.TimeStamp;
+		Group->Summary.EventName = Event.EventName;
+		Group->Summary.Session = Event.Session;
+		Group->Summary.Priority = Event.Priority;
+		for (const FAptabaseEventAttribute* Attribute : StringAttributes)
+		{
+			Group->Summary.EventAttributes.Add(*Attribute);
+		}
+	}
+
+	++Group->Count;
+	Group->SpoolRefs.Add(Event.SpoolId);
+	Group->Summary.Priority = FMath::Max(Group->Summary.Priority, Event.Priority);
+
+	const FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+	for (const FAptabaseEventAttribute& Attribute : Event.EventAttributes)
+	{
+		if (!IsNumeric(Attribute))
+		{
+			continue;
+		}
+
+		const double Value = GetNumericValue(Attribute);
+		const FAptabaseName Key = NameTable.Resolve(Attribute.Key).CaseInsensitiveName;
+
+		FNumericStats* Stats = Group->NumericStats.FindByPredicate([&NameTable, Key](const FNumericStats& Candidate)
+		{
+			return NameTable.Resolve(Candidate.Key).CaseInsensitiveName == Key;
+		});
+
+		if (!Stats)
+		{
+			Stats = &Group->NumericStats.Add_GetRef({Attribute.Key, 0.0, Value, Value});
+		}
+
+		Stats->Sum += Value;
+		Stats->Min = FMath::Min(Stats->Min, Value);
+		Stats->Max = FMath::Max(Stats->Max, Value);
+	}
+
+	return true;
+}
+
+void FAptabaseEventAggregator::EmitCompletedWindows(double Now, FAptabaseEventBuffer& OutEvents, FAptabaseSpoolRefs& OutSpoolRefs)
+{
+	for (auto It = Groups.CreateIterator(); It; ++It)
+	{
+		TArray<FGroup>& NameGroups = It.Value();
+		for (int32 GroupIndex = 0; GroupIndex < NameGroups.Num(); ++GroupIndex)
+		{
+			if (NameGroups[GroupIndex].WindowEnd <= Now)
+			{
+				OutSpoolRefs.Append(NameGroups[GroupIndex].SpoolRefs);
+				OutEvents.Add(MakeSummaryEvent(MoveTemp(NameGroups[GroupIndex])));
+				NameGroups.RemoveAt(GroupIndex--, EAllowShrinking::No);
+			}
+		}
+
+		if (NameGroups.IsEmpty())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FAptabaseEventAggregator::EmitAll(FAptabaseEventBuffer& OutEvents, FAptabaseSpoolRefs& OutSpoolRefs)
+{
+	for (TPair<FGroupKey, TArray<FGroup>>& NameGroups : Groups)
+	{
+		for (FGroup& Group : NameGroups.Value)
+		{
+			OutSpoolRefs.Append(Group.SpoolRefs);
+			OutEvents.Add(MakeSummaryEvent(MoveTemp(Group)));
+		}
+	}
+
+	Groups.Reset();
+}
+
+double FAptabaseEventAggregator::GetNextWindowEnd() const
+{
+	double NextWindowEnd = TNumericLimits<double>::Max();
+	for (const TPair<FGroupKey, TArray<FGroup>>& NameGroups : Groups)
+	{
+		for (const FGroup& Group : NameGroups.Value)
+		{
+			NextWindowEnd = FMath::Min(NextWindowEnd, Group.WindowEnd);
+		}
+	}
+
+	return NextWindowEnd;
+}
+
+FAptabaseEventPayload FAptabaseEventAggregator::MakeSummaryEvent(FGroup&& Group)
+{
+	FAptabaseEventPayload Summary = MoveTemp(Group.Summary);
+	Summary.EventAttributes.Reserve(Summary.EventAttributes.Num() + 1 + Group.NumericStats.Num() * 3);
+	AddNumericAttribute(Summary.EventAttributes, GetSummaryKey(FAptabaseName(), CountSuffix), static_cast<double>(Group.Count));
+
+	for (const FNumericStats& Stats : Group.NumericStats)
+	{
+		AddNumericAttribute(Summary.EventAttributes, GetSummaryKey(Stats.Key, SumSuffix), Stats.Sum);
+		AddNumericAttribute(Summary.EventAttributes, GetSummaryKey(Stats.Key, MinSuffix), Stats.Min);
+		AddNumericAttribute(Summary.EventAttributes, GetSummaryKey(Stats.Key, MaxSuffix), Stats.Max);
+	}
+
+	return Summary;
+}
+
+FAptabaseName FAptabaseEventAggregator::GetSummaryKey(FAptabaseName Key, const TCHAR* Suffix)
+{
+	if (const FAptabaseName* SummaryKey = SummaryKeys.Find({Key, Suffix}))
+	{
+		return *SummaryKey;
+	}
+
+	FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+	const FAptabaseName SummaryKey = NameTable.Intern(NameTable.Resolve(Key).String + Suffix);
+	SummaryKeys.Add({Key, Suffix}, SummaryKey);
+	return SummaryKey;
+}
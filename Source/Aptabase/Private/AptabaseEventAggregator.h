@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Containers/ArrayView.h>
+#include <Containers/Map.h>
+#include <Containers/UnrealString.h>
+
+#include "AptabaseData.h"
+
+class FAptabaseEventBuffer;
+struct FAptabaseAggregationRule;
+
+/**
+ * @brief Folds occurrences of high-frequency events into a single summary event per time window
+ * @note Occurrences are grouped by event name, string and boolean attributes. Numeric attributes are reduced to their sum, min and max.
+ * Only accessed from the pipeline thread.
+ */
+class FAptabaseEventAggregator
+{
+public:
+	/**
+	 * @brief Replaces the set of aggregated events. Groups that are already open keep their window.
+	 */
+	void Configure(TConstArrayView<FAptabaseAggregationRule> Rules);
+	/**
+	 * @brief Folds the event into its group if its name is aggregated
+	 * @param Now Current time, from FPlatformTime::Seconds
+	 * @return false if the event isn't aggregated and must be sent as-is
+	 */
+	bool Add(const FAptabaseEventPayload& Event, double Now);
+	/**
+	 * @brief Appends a summary event for every group whose window ended
+	 * @param OutSpoolRefs Receives the spool records of the occurrences folded into the emitted summaries
+	 */
+	void EmitCompletedWindows(double Now, FAptabaseEventBuffer& OutEvents, FAptabaseSpoolRefs& OutSpoolRefs);
+	/**
+	 * @brief Appends a summary event for every group, regardless of its window
+	 * @param OutSpoolRefs Receives the spool records of the occurrences folded into the emitted summaries
+	 */
+	void EmitAll(FAptabaseEventBuffer& OutEvents, FAptabaseSpoolRefs& OutSpoolRefs);
+	/**
+	 * @brief Time the earliest open window ends, from FPlatformTime::Seconds
+	 */
+	double GetNextWindowEnd() const;
+	/**
+	 * @brief Whether no group is waiting for its window to end
+	 */
+	bool IsEmpty() const { return Groups.IsEmpty(); }
+
+private:
+	/**
+	 * @brief Reduction of a numeric attribute over the occurrences of a group
+	 */
+	struct FNumericStats
+	{
+		FAptabaseName Key;
+		double Sum = 0.0;
+		double Min = 0.0;
+		double Max = 0.0;
+	};
+	/**
+	 * @brief Event name and session shared by the groups of a Groups entry
+	 */
+	struct FGroupKey
+	{
+		FAptabaseName EventName;
+		const FAptabaseSessionSnapshot* Session = nullptr;
+
+		bool operator==(const FGroupKey& Other) const { return EventName == Other.EventName && Session == Other.Session; }
+		friend uint32 GetTypeHash(const FGroupKey& Key) { return HashCombineFast(GetTypeHash(Key.EventName), PointerHash(Key.Session)); }
+	};
+	/**
+	 * @brief Occurrences of an event sharing the same string attributes and session
+	 */
+	struct FGroup
+	{
+		/**
+		 * @brief First occurrence with only its string attributes left, sorted by key, becomes the summary event
+		 * @note Holds on to the session, which keeps the pointer in the group's key valid
+		 */
+		FAptabaseEventPayload Summary;
+		/**
+		 * @brief Numeric attributes, in the order they were first seen
+		 */
+		TArray<FNumericStats> NumericStats;
+		/**
+		 * @brief Number of occurrences folded into the group
+		 */
+		int64 Count = 0;
+		/**
+		 * @brief Time the window of the group ends, from FPlatformTime::Seconds
+		 */
+		double WindowEnd = 0.0;
+		/**
+		 * @brief Spool records of the occurrences, kept until the summary replaces them on disk
+		 */
+		FAptabaseSpoolRefs SpoolRefs;
+	};
+	/**
+	 * @brief Builds the summary event of a group
+	 */
+	FAptabaseEventPayload MakeSummaryEvent(FGroup&& Group);
+	/**
+	 * @brief Interned name of a summary attribute, e.g. "damage_sum" for the sum of "damage"
+	 */
+	FAptabaseName GetSummaryKey(FAptabaseName Key, const TCHAR* Suffix);
+	/**
+	 * @brief Length of the window of each aggregated event, by event name
+	 */
+	TMap<FAptabaseName, double> WindowByEventName;
+	/**
+	 * @brief Open groups by event name and session, one per combination of string attributes
+	 * @note Entries never stay empty, a name and session without open groups are removed
+	 */
+	TMap<FGroupKey, TArray<FGroup>> Groups;
+	/**
+	 * @brief Summary attribute names already interned, by attribute key and suffix
+	 */
+	TMap<TPair<FAptabaseName, const TCHAR*>, FAptabaseName> SummaryKeys;
+};
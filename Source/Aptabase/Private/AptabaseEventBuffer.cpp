@@ -0,0 +1,166 @@
+#include "AptabaseEventBuffer.h"
+
+void FAptabaseEventBuffer::Add(FAptabaseEventPayload&& Event)
+{
+	int32 SessionIndex = INDEX_NONE;
+	if (const int32* ExistingSessionIndex = SessionIndexBySnapshot.Find(Event.Session.Get()))
+	{
+		SessionIndex = *ExistingSessionIndex;
+	}
+	else
+	{
+		SessionIndex = Sessions.Add(Event.Session);
+		SessionIndexBySnapshot.Add(Event.Session.Get(), SessionIndex);
+	}
+
+	TimeStampTicks.Add(Event.TimeStamp.GetTicks());
+	EventNames.Add(Event.EventName);
+	SessionIndices.Add(SessionIndex);
+	Priorities.Add(Event.Priority);
+	SpoolIds.Add(Event.SpoolId);
+	AttributeOffsets.Add(Attributes.Num());
+
+	Attributes.Reserve(Attributes.Num() + Event.EventAttributes.Num());
+	for (FAptabaseEventAttribute& Attribute : Event.EventAttributes)
+	{
+		Attributes.Emplace(MoveTemp(Attribute));
+	}
+
+	Event.EventAttributes.Empty();
+}
+
+TConstArrayView<FAptabaseEventAttribute> FAptabaseEventBuffer::GetAttributes(int32 Index) const
+{
+	const int32 FirstAttribute = AttributeOffsets[Index];
+	const int32 EndAttribute = Index + 1 < AttributeOffsets.Num() ? AttributeOffsets[Index + 1] : Attributes.Num();
+	return MakeArrayView(Attributes).Mid(FirstAttribute, EndAttribute - FirstAttribute);
+}
+
+void FAptabaseEventBuffer::GetSpoolRefs(int32 FirstIndex, int32 Count, FAptabaseSpoolRefs& OutSpoolRefs) const
+{
+	for (int32 Index = FirstIndex; Index < FirstIndex + Count; ++Index)
+	{
+		OutSpoolRefs.Add(SpoolIds[Index]);
+	}
+}
+
+int64 FAptabaseEventBuffer::GetAllocatedSize(int32 FirstIndex, int32 Count) const
+{
+	int64 Size = 0;
+	for (int32 Index = FirstIndex; Index < FirstIndex + Count; ++Index)
+	{
+		Size += GetEventSize(GetAttributes(Index));
+	}
+
+	return Size;
+}
+
+SIZE_T FAptabaseEventBuffer::GetEventSize(TConstArrayView<FAptabaseEventAttribute> EventAttributes)
+{
+	// One entry in each column
+	SIZE_T Size = sizeof(int64) + sizeof(FAptabaseName) + sizeof(int32) + sizeof(EAptabaseEventPriority) + sizeof(uint64) + sizeof(int32);
+	Size += EventAttributes.Num() * sizeof(FAptabaseEventAttribute);
+
+	for (const FAptabaseEventAttribute& Attribute : EventAttributes)
+	{
+		if (Attribute.Value.IsType<FString>())
+		{
+			Size += Attribute.Value.Get<FString>().GetAllocatedSize();
+		}
+	}
+
+	return Size;
+}
+
+void FAptabaseEventBuffer::RemoveFirst(int32 Count)
+{
+	if (Count >= Num())
+	{
+		Reset();
+		return;
+	}
+
+	const int32 NumAttributesRemoved = AttributeOffsets[Count];
+
+	TimeStampTicks.RemoveAt(0, Count, EAllowShrinking::No);
+	EventNames.RemoveAt(0, Count, EAllowShrinking::No);
+	SessionIndices.RemoveAt(0, Count, EAllowShrinking::No);
+	Priorities.RemoveAt(0, Count, EAllowShrinking::No);
+	SpoolIds.RemoveAt(0, Count, EAllowShrinking::No);
+	AttributeOffsets.RemoveAt(0, Count, EAllowShrinking::No);
+	Attributes.RemoveAt(0, NumAttributesRemoved, EAllowShrinking::No);
+
+	for (int32& AttributeOffset : AttributeOffsets)
+	{
+		AttributeOffset -= NumAttributesRemoved;
+	}
+}
+
+int32 FAptabaseEventBuffer::RemoveAll(TFunctionRef<bool(int32 Index)> Predicate)
+{
+	const int32 NumEvents = Num();
+
+	// Kept events are compacted towards the front in a single pass, writes never get ahead of the event being read
+	int32 WriteIndex = 0;
+	int32 AttributeWriteIndex = 0;
+	for (int32 ReadIndex = 0; ReadIndex < NumEvents; ++ReadIndex)
+	{
+		const int32 FirstAttribute = AttributeOffsets[ReadIndex];
+		const int32 EndAttribute = ReadIndex + 1 < NumEvents ? AttributeOffsets[ReadIndex + 1] : Attributes.Num();
+
+		if (Predicate(ReadIndex))
+		{
+			continue;
+		}
+
+		if (WriteIndex != ReadIndex)
+		{
+			TimeStampTicks[WriteIndex] = TimeStampTicks[ReadIndex];
+			EventNames[WriteIndex] = EventNames[ReadIndex];
+			SessionIndices[WriteIndex] = SessionIndices[ReadIndex];
+			Priorities[WriteIndex] = Priorities[ReadIndex];
+			SpoolIds[WriteIndex] = SpoolIds[ReadIndex];
+		}
+
+		AttributeOffsets[WriteIndex] = AttributeWriteIndex;
+		for (int32 AttributeIndex = FirstAttribute; AttributeIndex < EndAttribute; ++AttributeIndex)
+		{
+			if (AttributeWriteIndex != AttributeIndex)
+			{
+				Attributes[AttributeWriteIndex] = MoveTemp(Attributes[AttributeIndex]);
+			}
+			++AttributeWriteIndex;
+		}
+
+		++WriteIndex;
+	}
+
+	if (WriteIndex == 0)
+	{
+		Reset();
+		return NumEvents;
+	}
+
+	TimeStampTicks.SetNum(WriteIndex, EAllowShrinking::No);
+	EventNames.SetNum(WriteIndex, EAllowShrinking::No);
+	SessionIndices.SetNum(WriteIndex, EAllowShrinking::No);
+	Priorities.SetNum(WriteIndex, EAllowShrinking::No);
+	SpoolIds.SetNum(WriteIndex, EAllowShrinking::No);
+	AttributeOffsets.SetNum(WriteIndex, EAllowShrinking::No);
+	Attributes.SetNum(AttributeWriteIndex, EAllowShrinking::No);
+
+	return NumEvents - WriteIndex;
+}
+
+void FAptabaseEventBuffer::Reset()
+{
+	TimeStampTicks.Reset();
+	EventNames.Reset();
+	SessionIndices.Reset();
+	Priorities.Reset();
+	SpoolIds.Reset();
+	AttributeOffsets.Reset();
+	Attributes.Reset();
+	Sessions.Reset();
+	SessionIndexBySnapshot.Reset();
+}
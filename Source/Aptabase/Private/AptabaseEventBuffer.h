@@ -0,0 +1,124 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Containers/ArrayView.h>
+#include <Containers/Map.h>
+#include <Templates/Function.h>
+#include <Templates/SharedPointer.h>
+
+#include "AptabaseData.h"
+
+/**
+ * @brief Queued events stored column by column, so flushing and the overflow policies only touch the data they need
+ * @note Time stamps stay raw ticks until the serializer formats them, and the attributes of every event share one array.
+ * Only accessed from the pipeline thread.
+ */
+class FAptabaseEventBuffer
+{
+public:
+	/**
+	 * @brief Appends an event, taking its attributes over
+	 */
+	void Add(FAptabaseEventPayload&& Event);
+	/**
+	 * @brief Number of buffered events
+	 */
+	int32 Num() const { return EventNames.Num(); }
+	/**
+	 * @brief Whether no event is buffered
+	 */
+	bool IsEmpty() const { return EventNames.IsEmpty(); }
+	/**
+	 * @brief Time the event happened (UTC)
+	 */
+	FDateTime GetTimeStamp(int32 Index) const { return FDateTime(TimeStampTicks[Index]); }
+	/**
+	 * @brief Name of the event
+	 */
+	FAptabaseName GetEventName(int32 Index) const { return EventNames[Index]; }
+	/**
+	 * @brief Session id and system properties of the event
+	 */
+	const TSharedPtr<const FAptabaseSessionSnapshot>& GetSession(int32 Index) const { return Sessions[SessionIndices[Index]]; }
+	/**
+	 * @brief Attributes of the event
+	 */
+	TConstArrayView<FAptabaseEventAttribute> GetAttributes(int32 Index) const;
+	/**
+	 * @brief Importance of the event when the queue overflows
+	 */
+	EAptabaseEventPriority GetPriority(int32 Index) const { return Priorities[Index]; }
+	/**
+	 * @brief Spool record the event was journaled to, 0 when it isn't persisted
+	 */
+	uint64 GetSpoolId(int32 Index) const { return SpoolIds[Index]; }
+	/**
+	 * @brief Tags an event added before it was journaled, e.g. a summary event emitted by the aggregator
+	 */
+	void SetSpoolId(int32 Index, uint64 SpoolId) { SpoolIds[Index] = SpoolId; }
+	/**
+	 * @brief Adds the spool records of Count events starting at FirstIndex to OutSpoolRefs
+	 */
+	void GetSpoolRefs(int32 FirstIndex, int32 Count, FAptabaseSpoolRefs& OutSpoolRefs) const;
+	/**
+	 * @brief Memory held by Count events starting at FirstIndex, as counted against the queue budget
+	 */
+	int64 GetAllocatedSize(int32 FirstIndex, int32 Count) const;
+	/**
+	 * @brief Memory an event with these attributes takes once buffered
+	 * @note Names and keys are shared through the name table and sessions by every event referencing them, neither counts towards a single event
+	 */
+	static SIZE_T GetEventSize(TConstArrayView<FAptabaseEventAttribute> EventAttributes);
+	/**
+	 * @brief Removes the Count oldest events
+	 */
+	void RemoveFirst(int32 Count);
+	/**
+	 * @brief Removes the events the predicate returns true for, keeping the order of the others
+	 * @note The predicate is called once per event, oldest first, with the index the event had before the call
+	 * @return Number of removed events
+	 */
+	int32 RemoveAll(TFunctionRef<bool(int32 Index)> Predicate);
+	/**
+	 * @brief Removes every event, keeping the allocations
+	 */
+	void Reset();
+
+private:
+	/**
+	 * @brief FDateTime ticks of each event
+	 */
+	TArray<int64> TimeStampTicks;
+	/**
+	 * @brief Name of each event
+	 */
+	TArray<FAptabaseName> EventNames;
+	/**
+	 * @brief Index of each event's session in Sessions
+	 */
+	TArray<int32> SessionIndices;
+	/**
+	 * @brief Priority of each event
+	 */
+	TArray<EAptabaseEventPriority> Priorities;
+	/**
+	 * @brief Spool record of each event
+	 */
+	TArray<uint64> SpoolIds;
+	/**
+	 * @brief Index of each event's first attribute in Attributes, its last one comes right before the next event's first one
+	 */
+	TArray<int32> AttributeOffsets;
+	/**
+	 * @brief Attributes of every event, in event order
+	 */
+	TArray<FAptabaseEventAttribute> Attributes;
+	/**
+	 * @brief Distinct sessions referenced by the events, released once the buffer is emptied
+	 */
+	TArray<TSharedPtr<const FAptabaseSessionSnapshot>> Sessions;
+	/**
+	 * @brief Index in Sessions of each snapshot
+	 */
+	TMap<const FAptabaseSessionSnapshot*, int32> SessionIndexBySnapshot;
+};
@@ -0,0 +1,133 @@
+#include "AptabaseEventSampler.h"
+
+#include <HAL/PlatformTime.h>
+#include <Misc/Crc.h>
+#include <Misc/ScopeLock.h>
+#include <Templates/TypeHash.h>
+#include <Templates/UniquePtr.h>
+
+#include "AptabaseSettings.h"
+
+FAptabaseEventSampler::~FAptabaseEventSampler()
+{
+	delete ActiveRuleSet.load();
+}
+
+void FAptabaseEventSampler::SetRules(TConstArrayView<FAptabaseSamplingRule> Rules)
+{
+	TUniquePtr<FRuleSet> RuleSet = MakeUnique<FRuleSet>();
+	RuleSet->Rules.SetNum(Rules.Num());
+
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		const FAptabaseSamplingRule& SamplingRule = Rules[RuleIndex];
+		if (SamplingRule.EventName.IsEmpty())
+		{
+			continue;
+		}
+
+		FRule& Rule = RuleSet->Rules[RuleIndex];
+		Rule.SampleRate = FMath::Clamp(SamplingRule.SampleRate, 0.0f, 1.0f);
+		Rule.PatternHash = FCrc::StrCrc32(*SamplingRule.EventName);
+
+		if (SamplingRule.MaxEventsPerSecond > 0.0f)
+		{
+			const double EmissionIntervalSeconds = 1.0 / SamplingRule.MaxEventsPerSecond;
+			Rule.EmissionIntervalCycles = FMath::Max<uint64>(1, static_cast<uint64>(EmissionIntervalSeconds / FPlatformTime::GetSecondsPerCycle64()));
+			Rule.BurstToleranceCycles = Rule.EmissionIntervalCycles * (FMath::Max(1, SamplingRule.Burst) - 1);
+		}
+
+		if (SamplingRule.EventName.Contains(TEXT("*")) || SamplingRule.EventName.Contains(TEXT("?")))
+		{
+			RuleSet->WildcardRules.Emplace(SamplingRule.EventName, RuleIndex);
+		}
+		else if (!RuleSet->ExactRules.Contains(SamplingRule.EventName))
+		{
+			RuleSet->ExactRules.Add(SamplingRule.EventName, RuleIndex);
+		}
+	}
+
+	FScopeLock ScopeLock(&RuleSetsLock);
+
+	const bool bHasRules = !RuleSet->ExactRules.IsEmpty() || !RuleSet->WildcardRules.IsEmpty();
+	const FRuleSet* PreviousRuleSet = ActiveRuleSet.exchange(bHasRules ? RuleSet.Release() : nullptr);
+
+	// Events being sampled may still be reading the previous rules or their buckets
+	RuleSetReadEpochs.WaitForReaders();
+	delete PreviousRuleSet;
+}
+
+EAptabaseSamplingDecision FAptabaseEventSampler::Sample(const FString& EventName, uint32 SessionSeed, double& OutSampleWeight) const
+{
+	OutSampleWeight = 1.0;
+
+	const FAptabaseReadEpochs::FReadScope ReadScope(RuleSetReadEpochs);
+	const FRuleSet* RuleSet = ActiveRuleSet.load();
+	if (!RuleSet)
+	{
+		return EAptabaseSamplingDecision::Keep;
+	}
+
+	const FRule* Rule = nullptr;
+	if (const int32* RuleIndex = RuleSet->ExactRules.Find(EventName))
+	{
+		Rule = &RuleSet->Rules[*RuleIndex];
+	}
+	else
+	{
+		for (const TPair<FString, int32>& WildcardRule : RuleSet->WildcardRules)
+		{
+			if (EventName.MatchesWildcard(WildcardRule.Key))
+			{
+				Rule = &RuleSet->Rules[WildcardRule.Value];
+				break;
+			}
+		}
+	}
+
+	if (!Rule)
+	{
+		return EAptabaseSamplingDecision::Keep;
+	}
+
+	if (Rule->SampleRate < 1.0)
+	{
+		// Same session and rule, same decision: sampled sessions keep every occurrence so per-session funnels stay complete
+		const uint32 Hash = HashCombine(SessionSeed, Rule->PatternHash);
+		const double SessionPosition = (Hash & 0xFFFFFF) / static_cast<double>(0x1000000);
+		if (SessionPosition >= Rule->SampleRate)
+		{
+			return EAptabaseSamplingDecision::SampledOut;
+		}
+
+		OutSampleWeight = 1.0 / Rule->SampleRate;
+	}
+
+	if (Rule->EmissionIntervalCycles > 0 && !TryAcquire(*Rule))
+	{
+		return EAptabaseSamplingDecision::RateLimited;
+	}
+
+	return EAptabaseSamplingDecision::Keep;
+}
+
+bool FAptabaseEventSampler::TryAcquire(const FRule& Rule)
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+
+	uint64 TheoreticalArrival = Rule.TheoreticalArrivalCycles.load(std::memory_order_relaxed);
+	while (true)
+	{
+		// Each event takes one emission interval out of the bucket, which refills continuously up to the burst size
+		const uint64 Start = FMath::Max(TheoreticalArrival, Now);
+		if (Start - Now > Rule.BurstToleranceCycles)
+		{
+			return false;
+		}
+
+		if (Rule.TheoreticalArrivalCycles.compare_exchange_weak(TheoreticalArrival, Start + Rule.EmissionIntervalCycles, std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Containers/ArrayView.h>
+#include <Containers/Map.h>
+#include <Containers/UnrealString.h>
+#include <HAL/CriticalSection.h>
+
+#include <atomic>
+
+#include "AptabaseReadEpochs.h"
+
+struct FAptabaseSamplingRule;
+
+/**
+ * @brief Outcome of FAptabaseEventSampler::Sample
+ */
+enum class EAptabaseSamplingDecision : uint8
+{
+	/** The event is recorded */
+	Keep,
+	/** The session isn't part of the sample for this event */
+	SampledOut,
+	/** The event exceeded the rate limit of its rule */
+	RateLimited
+};
+
+/**
+ * @brief Decides which recorded events are kept, following the SamplingRules of the settings
+ * @note Sample is lock-free and callable from any thread. Rules can be replaced at any time, events already being sampled finish with the previous rules.
+ */
+class FAptabaseEventSampler
+{
+public:
+	~FAptabaseEventSampler();
+	/**
+	 * @brief Replaces the rules. Names without wildcards take precedence, then the first matching wildcard rule applies.
+	 * @note Rate limits start over with a full burst
+	 */
+	void SetRules(TConstArrayView<FAptabaseSamplingRule> Rules);
+	/**
+	 * @brief Applies the rule of the event, if any
+	 * @param SessionSeed Hash of the session id, so a session keeps or drops an event consistently
+	 * @param OutSampleWeight Number of events a kept event stands for, 1 unless its rule samples it
+	 */
+	EAptabaseSamplingDecision Sample(const FString& EventName, uint32 SessionSeed, double& OutSampleWeight) const;
+
+private:
+	/**
+	 * @brief Rule prepared for sampling
+	 */
+	struct FRule
+	{
+		/**
+		 * @brief Fraction of the sessions keeping the events, in [0, 1]
+		 */
+		double SampleRate = 1.0;
+		/**
+		 * @brief Hash of the event name pattern, mixed with the session seed so every rule samples different sessions
+		 */
+		uint32 PatternHash = 0;
+		/**
+		 * @brief Cycles between two events at the sustained rate, 0 without a rate limit
+		 */
+		uint64 EmissionIntervalCycles = 0;
+		/**
+		 * @brief How far ahead of the sustained rate the events can get, which is what allows a burst
+		 */
+		uint64 BurstToleranceCycles = 0;
+		/**
+		 * @brief Time the bucket is back to full, in cycles. Token bucket kept as a single value so it is updated with one compare-and-swap.
+		 */
+		mutable std::atomic<uint64> TheoreticalArrivalCycles = 0;
+	};
+	/**
+	 * @brief Immutable set of rules, only the rate limit state changes once it is published
+	 */
+	struct FRuleSet
+	{
+		TArray<FRule> Rules;
+		/**
+		 * @brief Index of the rule of every event name without wildcards
+		 */
+		TMap<FString, int32> ExactRules;
+		/**
+		 * @brief Wildcard patterns in order, with the index of their rule
+		 */
+		TArray<TPair<FString, int32>> WildcardRules;
+	};
+	/**
+	 * @brief Consumes a token from the rule's bucket
+	 * @return false if the bucket is empty
+	 */
+	static bool TryAcquire(const FRule& Rule);
+	/**
+	 * @brief Rules currently applied, owned by the sampler, null when no rule is set
+	 */
+	std::atomic<const FRuleSet*> ActiveRuleSet = nullptr;
+	/**
+	 * @brief Threads sampling, a replaced rule set is freed once none of them can still be reading it
+	 */
+	FAptabaseReadEpochs RuleSetReadEpochs;
+	/**
+	 * @brief Serializes SetRules calls
+	 */
+	FCriticalSection RuleSetsLock;
+};
@@ -0,0 +1,297 @@
+#include "AptabaseEventSerializer.h"
+
+#include "AptabaseData.h"
+#include "AptabaseEventBuffer.h"
+
+const TArray<uint8>& FAptabaseEventSerializer::SerializeBatch(TConstArrayView<FAptabaseEventPayload> Events)
+{
+	BeginBatch();
+
+	for (const FAptabaseEventPayload& Event : Events)
+	{
+		WriteEvent(Event);
+	}
+
+	return EndBatch();
+}
+
+void FAptabaseEventSerializer::BeginBatch()
+{
+	Buffer.Reset();
+	NumEvents = 0;
+
+	WriteLiteral("[");
+}
+
+void FAptabaseEventSerializer::WriteEvent(const FAptabaseEventPayload& Event)
+{
+	if (NumEvents > 0)
+	{
+		WriteLiteral(",");
+	}
+
+	WriteEventObject(Event.TimeStamp, Event.EventName, Event.Session, Event.EventAttributes);
+	++NumEvents;
+}
+
+void FAptabaseEventSerializer::WriteEvent(const FAptabaseEventBuffer& Events, int32 Index)
+{
+	if (NumEvents > 0)
+	{
+		WriteLiteral(",");
+	}
+
+	WriteEventObject(Events.GetTimeStamp(Index), Events.GetEventName(Index), Events.GetSession(Index), Events.GetAttributes(Index));
+	++NumEvents;
+}
+
+const TArray<uint8>& FAptabaseEventSerializer::EndBatch()
+{
+	WriteLiteral("]");
+	return Buffer;
+}
+
+void FAptabaseEventSerializer::WriteEventObject(const FDateTime& TimeStamp, FAptabaseName EventName, const TSharedPtr<const FAptabaseSessionSnapshot>& Session, TConstArrayView<FAptabaseEventAttribute> Attributes)
+{
+	WriteLiteral("{\"timeStamp\":");
+	WriteTimeStamp(TimeStamp);
+	WriteLiteral(",\"sessionId\":");
+	WriteString(Session->SessionId);
+	WriteLiteral(",\"eventName\":");
+	WriteName(EventName);
+	WriteLiteral(",\"systemProps\":");
+	WriteSystemProps(Session);
+	WriteLiteral(",\"props\":");
+	WriteAttributes(Attributes);
+	WriteLiteral("}");
+}
+
+void FAptabaseEventSerializer::WriteSystemProps(const TSharedPtr<const FAptabaseSessionSnapshot>& Session)
+{
+	if (Session == EncodedSnapshot)
+	{
+		Buffer.Append(EncodedSystemProps);
+		return;
+	}
+
+	const int32 Start = Buffer.Num();
+	const FAptabaseSystemProperties& SystemProps = Session->SystemProps;
+
+	// Field names and order follow FJsonObjectConverter::UStructToJsonObject(FAptabaseSystemProperties)
+	if (SystemProps.IsDebug)
+	{
+		WriteLiteral("{\"isDebug\":true");
+	}
+	else
+	{
+		WriteLiteral("{\"isDebug\":false");
+	}
+	WriteLiteral(",\"locale\":");
+	WriteString(SystemProps.Locale);
+	WriteLiteral(",\"appVersion\":");
+	WriteString(SystemProps.AppVersion);
+	WriteLiteral(",\"sdkVersion\":");
+	WriteString(SystemProps.SdkVersion);
+	WriteLiteral(",\"osName\":");
+	WriteString(SystemProps.OsName);
+	WriteLiteral(",\"osVersion\":");
+	WriteString(SystemProps.OsVersion);
+	WriteLiteral("}");
+
+	EncodedSnapshot = Session;
+	EncodedSystemProps.Reset();
+	EncodedSystemProps.Append(Buffer.GetData() + Start, Buffer.Num() - Start);
+}
+
+void FAptabaseEventSerializer::WriteAttributes(TConstArrayView<FAptabaseEventAttribute> Attributes)
+{
+	const FAptabaseNameTable& NameTable = FAptabaseNameTable::Get();
+
+	WriteLiteral("{");
+
+	bool bFirstField = true;
+	for (int32 AttributeIndex = 0; AttributeIndex < Attributes.Num(); ++AttributeIndex)
+	{
+		const FAptabaseName Key = NameTable.Resolve(Attributes[AttributeIndex].Key).CaseInsensitiveName;
+
+		// FJsonObject stores fields in a case-insensitive map: a repeated key keeps the position of its first
+		// occurrence but takes the key and value of its last one.
+		bool bSeenBefore = false;
+		for (int32 PreviousIndex = 0; PreviousIndex < AttributeIndex && !bSeenBefore; ++PreviousIndex)
+		{
+			bSeenBefore = NameTable.Resolve(Attributes[PreviousIndex].Key).CaseInsensitiveName == Key;
+		}
+
+		if (bSeenBefore)
+		{
+			continue;
+		}
+
+		int32 LastIndex = AttributeIndex;
+		for (int32 NextIndex = AttributeIndex + 1; NextIndex < Attributes.Num(); ++NextIndex)
+		{
+			if (NameTable.Resolve(Attributes[NextIndex].Key).CaseInsensitiveName == Key)
+			{
+				LastIndex = NextIndex;
+			}
+		}
+
+		const FAptabaseEventAttribute& Attribute = Attributes[LastIndex];
+
+		if (!bFirstField)
+		{
+			WriteLiteral(",");
+		}
+		bFirstField = false;
+
+		WriteName(Attribute.Key);
+		WriteLiteral(":");
+
+		const auto& AttributeValue = Attribute.Value;
+		if (AttributeValue.IsType<double>())
+		{
+			WriteNumber(AttributeValue.Get<double>());
+		}
+		else if (AttributeValue.IsType<float>())
+		{
+			WriteNumber(AttributeValue.Get<float>());
+		}
+		else if (AttributeValue.IsType<int64>())
+		{
+			WriteInteger(AttributeValue.Get<int64>());
+		}
+		else if (AttributeValue.IsType<bool>())
+		{
+			if (AttributeValue.Get<bool>())
+			{
+				WriteLiteral("true");
+			}
+			else
+			{
+				WriteLiteral("false");
+			}
+		}
+		else
+		{
+			WriteString(AttributeValue.Get<FString>());
+		}
+	}
+
+	WriteLiteral("}");
+}
+
+void FAptabaseEventSerializer::WriteName(FAptabaseName Name)
+{
+	if (!EncodedNames.IsValidIndex(Name.Index))
+	{
+		EncodedNames.SetNum(Name.Index + 1);
+	}
+
+	// An encoded string is never empty, it has its quotes at least
+	TArray<uint8>& EncodedName = EncodedNames[Name.Index];
+	if (EncodedName.IsEmpty())
+	{
+		WriteString(EncodedName, FAptabaseNameTable::Get().Resolve(Name).String);
+	}
+
+	Buffer.Append(EncodedName);
+}
+
+void FAptabaseEventSerializer::WriteTimeStamp(const FDateTime& TimeStamp)
+{
+	int32 Year, Month, Day;
+	TimeStamp.GetDate(Year, Month, Day);
+
+	ANSICHAR Formatted[32];
+	const int32 FormattedLength = FCStringAnsi::Snprintf(Formatted, UE_ARRAY_COUNT(Formatted), "\"%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\"", Year, Month, Day,
+		TimeStamp.GetHour(), TimeStamp.GetMinute(), TimeStamp.GetSecond(), TimeStamp.GetMillisecond());
+	Buffer.Append(reinterpret_cast<const uint8*>(Formatted), FormattedLength);
+}
+
+void FAptabaseEventSerializer::WriteString(TArray<uint8>& Output, FStringView Value)
+{
+	Output.Add('"');
+
+	const TCHAR* Data = Value.GetData();
+	const int32 Length = Value.Len();
+
+	int32 Index = 0;
+	while (Index < Length)
+	{
+		const TCHAR Char = Data[Index];
+
+		// Same escaping rules as TJsonWriter::WriteStringValue
+		switch (Char)
+		{
+		case TCHAR('\\'):
+			AppendLiteral(Output, "\\\\");
+			break;
+		case TCHAR('\n'):
+			AppendLiteral(Output, "\\n");
+			break;
+		case TCHAR('\t'):
+			AppendLiteral(Output, "\\t");
+			break;
+		case TCHAR('\b'):
+			AppendLiteral(Output, "\\b");
+			break;
+		case TCHAR('\f'):
+			AppendLiteral(Output, "\\f");
+			break;
+		case TCHAR('\r'):
+			AppendLiteral(Output, "\\r");
+			break;
+		case TCHAR('\"'):
+			AppendLiteral(Output, "\\\"");
+			break;
+		default:
+			if (Char < TCHAR(32))
+			{
+				ANSICHAR Escaped[8];
+				const int32 EscapedLength = FCStringAnsi::Snprintf(Escaped, UE_ARRAY_COUNT(Escaped), "\\u%04x", static_cast<uint32>(Char));
+				Output.Append(reinterpret_cast<const uint8*>(Escaped), EscapedLength);
+			}
+			else if (Char < TCHAR(128))
+			{
+				Output.Add(static_cast<uint8>(Char));
+			}
+			else
+			{
+				// Convert the whole run of non-ASCII characters at once so surrogate pairs stay together
+				int32 RunEnd = Index + 1;
+				while (RunEnd < Length && Data[RunEnd] >= TCHAR(128))
+				{
+					++RunEnd;
+				}
+
+				const int32 RunLength = RunEnd - Index;
+				const int32 EncodedLength = FPlatformString::ConvertedLength<UTF8CHAR>(Data + Index, RunLength);
+				const int32 Offset = Output.AddUninitialized(EncodedLength);
+				FPlatformString::Convert(reinterpret_cast<UTF8CHAR*>(Output.GetData() + Offset), EncodedLength, Data + Index, RunLength);
+
+				Index = RunEnd;
+				continue;
+			}
+			break;
+		}
+
+		++Index;
+	}
+
+	Output.Add('"');
+}
+
+void FAptabaseEventSerializer::WriteNumber(double Value)
+{
+	// TJsonWriter writes every number with 17 significant digits
+	ANSICHAR Number[32];
+	const int32 NumberLength = FCStringAnsi::Snprintf(Number, UE_ARRAY_COUNT(Number), "%.17g", Value);
+	Buffer.Append(reinterpret_cast<const uint8*>(Number), NumberLength);
+}
+
+void FAptabaseEventSerializer::WriteInteger(int64 Value)
+{
+	ANSICHAR Number[24];
+	const int32 NumberLength = FCStringAnsi::Snprintf(Number, UE_ARRAY_COUNT(Number), "%lld", static_cast<long long>(Value));
+	Buffer.Append(reinterpret_cast<const uint8*>(Number), NumberLength);
+}
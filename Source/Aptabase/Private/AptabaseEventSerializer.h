@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Containers/ArrayView.h>
+#include <Containers/StringView.h>
+#include <Templates/SharedPointer.h>
+
+#include "AptabaseNameTable.h"
+
+class FAptabaseEventBuffer;
+struct FAptabaseEventAttribute;
+struct FAptabaseEventPayload;
+struct FAptabaseSessionSnapshot;
+struct FDateTime;
+
+/**
+ * @brief Writes event batches straight to UTF-8 JSON, skipping the FJsonObject DOM and the TCHAR round-trip
+ * @note The output is byte-identical to serializing FAptabaseEventPayload::ToJsonObject with a condensed FJsonSerializer writer
+ */
+class FAptabaseEventSerializer
+{
+public:
+	/**
+	 * @brief Serializes the events as a JSON array into the internal buffer
+	 * @return UTF-8 encoded batch, valid until the next call. The allocation is reused between calls.
+	 */
+	const TArray<uint8>& SerializeBatch(TConstArrayView<FAptabaseEventPayload> Events);
+	/**
+	 * @brief Starts a new JSON array in the internal buffer, for building a batch one event at a time
+	 */
+	void BeginBatch();
+	/**
+	 * @brief Appends an event to the batch started with BeginBatch
+	 */
+	void WriteEvent(const FAptabaseEventPayload& Event);
+	/**
+	 * @brief Appends a buffered event to the batch started with BeginBatch, formatting its time stamp on the way
+	 */
+	void WriteEvent(const FAptabaseEventBuffer& Events, int32 Index);
+	/**
+	 * @brief Closes the batch started with BeginBatch
+	 * @return UTF-8 encoded batch, valid until the next call. The allocation is reused between calls.
+	 */
+	const TArray<uint8>& EndBatch();
+	/**
+	 * @brief Number of events written since BeginBatch
+	 */
+	int32 GetNumEvents() const { return NumEvents; }
+	/**
+	 * @brief Size of the batch written so far
+	 */
+	int32 GetNumBytes() const { return Buffer.Num(); }
+
+private:
+	/**
+	 * @brief Appends a single event object to the buffer
+	 */
+	void WriteEventObject(const FDateTime& TimeStamp, FAptabaseName EventName, const TSharedPtr<const FAptabaseSessionSnapshot>& Session, TConstArrayView<FAptabaseEventAttribute> Attributes);
+	/**
+	 * @brief Appends the "systemProps" object of a session, reusing the encoded bytes while the snapshot doesn't change
+	 */
+	void WriteSystemProps(const TSharedPtr<const FAptabaseSessionSnapshot>& Session);
+	/**
+	 * @brief Appends the "props" object, keeping FJsonObject semantics for duplicated keys
+	 */
+	void WriteAttributes(TConstArrayView<FAptabaseEventAttribute> Attributes);
+	/**
+	 * @brief Appends an interned name as a JSON string, encoding each name only the first time it is written
+	 */
+	void WriteName(FAptabaseName Name);
+	/**
+	 * @brief Appends a time as an ISO 8601 JSON string, same format as FDateTime::ToIso8601
+	 */
+	void WriteTimeStamp(const FDateTime& TimeStamp);
+	/**
+	 * @brief Appends a quoted and escaped JSON string
+	 */
+	void WriteString(FStringView Value) { WriteString(Buffer, Value); }
+	/**
+	 * @brief Appends a quoted and escaped JSON string to Output
+	 */
+	static void WriteString(TArray<uint8>& Output, FStringView Value);
+	/**
+	 * @brief Appends a number using the same formatting as TJsonWriter
+	 */
+	void WriteNumber(double Value);
+	/**
+	 * @brief Appends an integer with all of its digits
+	 */
+	void WriteInteger(int64 Value);
+	/**
+	 * @brief Appends a JSON literal or punctuation that doesn't need escaping
+	 */
+	template <int32 N>
+	void WriteLiteral(const ANSICHAR (&Literal)[N])
+	{
+		AppendLiteral(Buffer, Literal);
+	}
+	/**
+	 * @brief Appends a JSON literal or punctuation that doesn't need escaping to Output
+	 */
+	template <int32 N>
+	static void AppendLiteral(TArray<uint8>& Output, const ANSICHAR (&Literal)[N])
+	{
+		Output.Append(reinterpret_cast<const uint8*>(Literal), N - 1);
+	}
+	/**
+	 * @brief Reusable output buffer
+	 */
+	TArray<uint8> Buffer;
+	/**
+	 * @brief Number of events in the batch being written
+	 */
+	int32 NumEvents = 0;
+	/**
+	 * @brief Snapshot whose system properties are currently held in EncodedSystemProps
+	 */
+	TSharedPtr<const FAptabaseSessionSnapshot> EncodedSnapshot;
+	/**
+	 * @brief Encoded "systemProps" object of EncodedSnapshot
+	 */
+	TArray<uint8> EncodedSystemProps;
+	/**
+	 * @brief Encoded JSON string of every name written so far, by name index
+	 */
+	TArray<TArray<uint8>> EncodedNames;
+};
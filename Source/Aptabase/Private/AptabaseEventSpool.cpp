@@ -0,0 +1,451 @@
+#include "AptabaseEventSpool.h"
+
+#include <Async/Async.h>
+#include <HAL/FileManager.h>
+#include <HAL/PlatformFileManager.h>
+#include <Misc/FileHelper.h>
+#include <Misc/ScopeLock.h>
+
+#include "AptabaseData.h"
+#include "AptabaseLog.h"
+#include "AptabaseTrace.h"
+
+namespace
+{
+	constexpr uint32 RecordMagic = 0x32545041; // "APT2"
+	constexpr uint32 RecordTypeBatch = 1;
+	constexpr uint32 RecordTypeAcknowledge = 2;
+
+	// Magic, Type, Id, NumEvents, BodySize, OldestEventTicks, Checksum
+	constexpr int32 RecordHeaderSize = sizeof(uint32) + sizeof(uint32) + sizeof(uint64) + sizeof(uint32) + sizeof(uint32) + sizeof(int64) + sizeof(uint32);
+
+	// Records written before batches carried the time of their oldest event, still read so an update doesn't lose the spool
+	constexpr uint32 LegacyRecordMagic = 0x52545041; // "APTR"
+	constexpr int32 LegacyRecordHeaderSize = RecordHeaderSize - sizeof(int64);
+
+	// Compaction only kicks in once acknowledged records take up a meaningful amount of space
+	constexpr int64 MinDeadBytesForCompaction = 64 * 1024;
+
+	struct FRecordHeader
+	{
+		uint32 Magic = RecordMagic;
+		uint32 Type = 0;
+		uint64 Id = 0;
+		uint32 NumEvents = 0;
+		uint32 BodySize = 0;
+		int64 OldestEventTicks = 0;
+		uint32 Checksum = 0;
+	};
+
+	void WriteHeader(const FRecordHeader& Header, uint8* OutBytes)
+	{
+		FMemory::Memcpy(OutBytes, &Header.Magic, sizeof(uint32));
+		FMemory::Memcpy(OutBytes + 4, &Header.Type, sizeof(uint32));
+		FMemory::Memcpy(OutBytes + 8, &Header.Id, sizeof(uint64));
+		FMemory::Memcpy(OutBytes + 16, &Header.NumEvents, sizeof(uint32));
+		FMemory::Memcpy(OutBytes + 20, &Header.BodySize, sizeof(uint32));
+		FMemory::Memcpy(OutBytes + 24, &Header.OldestEventTicks, sizeof(int64));
+		FMemory::Memcpy(OutBytes + 32, &Header.Checksum, sizeof(uint32));
+	}
+
+	/**
+	 * @return Size of the header, INDEX_NONE if the bytes don't start with a record
+	 */
+	int32 ReadHeader(const uint8* Bytes, int64 NumBytes, FRecordHeader& OutHeader)
+	{
+		if (NumBytes < static_cast<int64>(sizeof(uint32)))
+		{
+			return INDEX_NONE;
+		}
+
+		FMemory::Memcpy(&OutHeader.Magic, Bytes, sizeof(uint32));
+		const int32 HeaderSize = OutHeader.Magic == RecordMagic ? RecordHeaderSize : OutHeader.Magic == LegacyRecordMagic ? LegacyRecordHeaderSize : INDEX_NONE;
+		if (HeaderSize == INDEX_NONE || NumBytes < HeaderSize)
+		{
+			return INDEX_NONE;
+		}
+
+		FMemory::Memcpy(&OutHeader.Type, Bytes + 4, sizeof(uint32));
+		FMemory::Memcpy(&OutHeader.Id, Bytes + 8, sizeof(uint64));
+		FMemory::Memcpy(&OutHeader.NumEvents, Bytes + 16, sizeof(uint32));
+		FMemory::Memcpy(&OutHeader.BodySize, Bytes + 20, sizeof(uint32));
+		if (HeaderSize == RecordHeaderSize)
+		{
+			FMemory::Memcpy(&OutHeader.OldestEventTicks, Bytes + 24, sizeof(int64));
+		}
+		FMemory::Memcpy(&OutHeader.Checksum, Bytes + HeaderSize - sizeof(uint32), sizeof(uint32));
+		return HeaderSize;
+	}
+
+	uint32 ComputeChecksum(const uint8* HeaderBytes, int32 HeaderSize, const uint8* Body, int32 BodySize)
+	{
+		const uint32 HeaderCrc = FCrc::MemCrc32(HeaderBytes, HeaderSize - sizeof(uint32));
+		return FCrc::MemCrc32(Body, BodySize, HeaderCrc);
+	}
+} // namespace
+
+FAptabaseEventSpool::FAptabaseEventSpool(const FString& InFilePath) :
+	FilePath(InFilePath)
+{
+}
+
+FAptabaseEventSpool::~FAptabaseEventSpool()
+{
+	Close();
+}
+
+TArray<TSharedRef<FAptabaseEventBatch>> FAptabaseEventSpool::Open()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+
+	// A compaction interrupted between removing the old file and renaming the new one leaves only the temporary file behind
+	const FString TempFilePath = FilePath + TEXT(".tmp");
+	if (!PlatformFile.FileExists(*FilePath) && PlatformFile.FileExists(*TempFilePath))
+	{
+		PlatformFile.MoveFile(*FilePath, *TempFilePath);
+	}
+
+	TArray<uint8> Contents;
+	FFileHelper::LoadFileToArray(Contents, *FilePath, FILEREAD_Silent);
+
+	TMap<uint64, TSharedRef<FAptabaseEventBatch>> PendingBatches;
+
+	int64 Offset = 0;
+	while (Offset < Contents.Num())
+	{
+		const uint8* HeaderBytes = Contents.GetData() + Offset;
+		FRecordHeader Header;
+		const int32 HeaderSize = ReadHeader(HeaderBytes, Contents.Num() - Offset, Header);
+
+		const int64 RecordSize = HeaderSize + static_cast<int64>(Header.BodySize);
+		if (HeaderSize == INDEX_NONE || Offset + RecordSize > Contents.Num())
+		{
+			UE_LOG(LogAptabase, Warning, TEXT("Event spool is truncated at offset %lld. Remaining data will be discarded."), Offset);
+			break;
+		}
+
+		const uint8* Body = HeaderBytes + HeaderSize;
+		if (Header.Checksum != ComputeChecksum(HeaderBytes, HeaderSize, Body, Header.BodySize))
+		{
+			UE_LOG(LogAptabase, Warning, TEXT("Event spool record at offset %lld is corrupted. Remaining data will be discarded."), Offset);
+			break;
+		}
+
+		if (Header.Type == RecordTypeBatch)
+		{
+			const TSharedRef<FAptabaseEventBatch> Batch = MakeShared<FAptabaseEventBatch>();
+			Batch->SpoolId = Header.Id;
+			Batch->SpoolRefs.Add(Header.Id, Header.NumEvents);
+			Batch->NumEvents = Header.NumEvents;
+			Batch->Body.Append(Body, Header.BodySize);
+
+			// Legacy records don't know how old their events are, they are treated as recorded now
+			if (Header.OldestEventTicks > 0)
+			{
+				Batch->OldestEventTime = FDateTime(Header.OldestEventTicks);
+			}
+
+			PendingBatches.Add(Header.Id, Batch);
+			LiveRecords.Add(Header.Id, {Offset, RecordSize, static_cast<int32>(Header.NumEvents)});
+		}
+		else if (Header.Type == RecordTypeAcknowledge)
+		{
+			PendingBatches.Remove(Header.Id);
+			LiveRecords.Remove(Header.Id);
+		}
+
+		NextId = FMath::Max(NextId, Header.Id + 1);
+		Offset += RecordSize;
+	}
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, true));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Failed to open the event spool %s. Events will only be kept in memory."), *FilePath);
+	}
+	ScopeLock.Unlock();
+
+	// Drop the acknowledged and corrupted records before appending anything new
+	Compact();
+
+	TArray<TSharedRef<FAptabaseEventBatch>> UnacknowledgedBatches;
+	PendingBatches.GenerateValueArray(UnacknowledgedBatches);
+	UnacknowledgedBatches.Sort([](const TSharedRef<FAptabaseEventBatch>& A, const TSharedRef<FAptabaseEventBatch>& B) { return A->SpoolId < B->SpoolId; });
+
+	if (!UnacknowledgedBatches.IsEmpty())
+	{
+		UE_LOG(LogAptabase, Log, TEXT("Found %d unsent batches from a previous run in the event spool."), UnacknowledgedBatches.Num());
+	}
+
+	return UnacknowledgedBatches;
+}
+
+uint64 FAptabaseEventSpool::ReserveId()
+{
+	FScopeLock ScopeLock(&Lock);
+	return NextId++;
+}
+
+bool FAptabaseEventSpool::Append(FAptabaseEventBatch& Batch)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (Batch.SpoolId == 0)
+	{
+		Batch.SpoolId = NextId++;
+	}
+
+	const int64 Offset = WriteRecord(RecordTypeBatch, Batch.SpoolId, Batch.NumEvents, Batch.OldestEventTime.GetTicks(), Batch.Body);
+	if (Offset == INDEX_NONE)
+	{
+		return false;
+	}
+
+	LiveRecords.Add(Batch.SpoolId, {Offset, RecordHeaderSize + Batch.Body.Num(), Batch.NumEvents});
+	return true;
+}
+
+bool FAptabaseEventSpool::IsPersisted(const FAptabaseEventBatch& Batch)
+{
+	FScopeLock ScopeLock(&Lock);
+	return LiveRecords.Contains(Batch.SpoolId);
+}
+
+bool FAptabaseEventSpool::Load(FAptabaseEventBatch& Batch)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	const FRecordLocation* Location = LiveRecords.Find(Batch.SpoolId);
+	if (!Location)
+	{
+		return false;
+	}
+
+	// Appends are flushed to the OS as they happen, a separate read handle sees them
+	const TUniquePtr<IFileHandle> ReadHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePath, true));
+	if (!ReadHandle.IsValid() || !ReadHandle->Seek(Location->Offset))
+	{
+		return false;
+	}
+
+	TArray<uint8> Record;
+	Record.SetNumUninitialized(Location->Size);
+	if (!ReadHandle->Read(Record.GetData(), Record.Num()))
+	{
+		return false;
+	}
+
+	FRecordHeader Header;
+	const int32 HeaderSize = ReadHeader(Record.GetData(), Record.Num(), Header);
+	const uint8* Body = Record.GetData() + HeaderSize;
+	if (HeaderSize == INDEX_NONE || Header.Id != Batch.SpoolId || HeaderSize + static_cast<int64>(Header.BodySize) != Location->Size ||
+		Header.Checksum != ComputeChecksum(Record.GetData(), HeaderSize, Body, Header.BodySize))
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Event spool record %llu is corrupted."), Batch.SpoolId);
+		return false;
+	}
+
+	Batch.Body.Reset();
+	Batch.Body.Append(Body, Header.BodySize);
+	return true;
+}
+
+void FAptabaseEventSpool::Release(const FAptabaseSpoolRefs& SpoolRefs)
+{
+	if (SpoolRefs.IsEmpty())
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+
+	for (const TPair<uint64, int32>& Record : SpoolRefs.Records)
+	{
+		FRecordLocation* Location = LiveRecords.Find(Record.Key);
+		if (!Location)
+		{
+			continue;
+		}
+
+		Location->NumPendingEvents -= Record.Value;
+		if (Location->NumPendingEvents > 0)
+		{
+			continue;
+		}
+
+		const int64 RecordSize = Location->Size;
+		LiveRecords.Remove(Record.Key);
+
+		if (WriteRecord(RecordTypeAcknowledge, Record.Key, 0, 0, {}) != INDEX_NONE)
+		{
+			DeadBytes += RecordSize + RecordHeaderSize;
+		}
+	}
+
+	CompactInBackgroundIfNeeded();
+}
+
+void FAptabaseEventSpool::Acknowledge(const FAptabaseEventBatch& Batch)
+{
+	Release(Batch.SpoolRefs);
+}
+
+void FAptabaseEventSpool::Close()
+{
+	if (CompactionTask.IsValid())
+	{
+		CompactionTask.Wait();
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	FileHandle.Reset();
+}
+
+int64 FAptabaseEventSpool::WriteRecord(uint32 Type, uint64 Id, int32 NumEvents, int64 OldestEventTicks, TConstArrayView<uint8> Body)
+{
+	if (!FileHandle.IsValid())
+	{
+		return INDEX_NONE;
+	}
+
+	FRecordHeader Header;
+	Header.Type = Type;
+	Header.Id = Id;
+	Header.NumEvents = NumEvents;
+	Header.BodySize = Body.Num();
+	Header.OldestEventTicks = OldestEventTicks;
+
+	uint8 HeaderBytes[RecordHeaderSize];
+	WriteHeader(Header, HeaderBytes);
+	Header.Checksum = ComputeChecksum(HeaderBytes, RecordHeaderSize, Body.GetData(), Body.Num());
+	WriteHeader(Header, HeaderBytes);
+
+	const int64 Offset = FileHandle->Tell();
+	if (!FileHandle->Write(HeaderBytes, RecordHeaderSize) || (!Body.IsEmpty() && !FileHandle->Write(Body.GetData(), Body.Num())))
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Failed to write to the event spool %s."), *FilePath);
+		return INDEX_NONE;
+	}
+
+	// Hand the data over to the OS so it survives the process crashing, without paying for a sync to the physical disk
+	FileHandle->Flush();
+	return Offset;
+}
+
+void FAptabaseEventSpool::Compact()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// Records appended from here on are past SnapshotEnd and carried over as they are once the copy is done
+	TArray<TPair<uint64, FRecordLocation>> Records;
+	int64 SnapshotEnd = 0;
+	int64 SnapshotDeadBytes = 0;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (!FileHandle.IsValid())
+		{
+			return;
+		}
+
+		Records = LiveRecords.Array();
+		SnapshotEnd = FileHandle->Tell();
+		SnapshotDeadBytes = DeadBytes;
+	}
+
+	Records.Sort([](const TPair<uint64, FRecordLocation>& A, const TPair<uint64, FRecordLocation>& B) { return A.Value.Offset < B.Value.Offset; });
+
+	const FString TempFilePath = FilePath + TEXT(".tmp");
+	TUniquePtr<IFileHandle> ReadHandle(PlatformFile.OpenRead(*FilePath, true));
+	TUniquePtr<IFileHandle> TempHandle(PlatformFile.OpenWrite(*TempFilePath));
+
+	// Copies Size bytes at Offset from the spool to the end of the temporary file, false if any read or write fails
+	TArray<uint8> CopyBuffer;
+	auto CopyToTempFile = [&ReadHandle, &TempHandle, &CopyBuffer](int64 Offset, int64 Size)
+	{
+		CopyBuffer.SetNumUninitialized(static_cast<int32>(Size), EAllowShrinking::No);
+		return ReadHandle->Seek(Offset) && ReadHandle->Read(CopyBuffer.GetData(), Size) && TempHandle->Write(CopyBuffer.GetData(), Size);
+	};
+
+	// The live records are copied without holding the lock, appends and acknowledgements carry on meanwhile
+	bool bSucceeded = ReadHandle.IsValid() && TempHandle.IsValid();
+	TMap<uint64, int64> CompactedOffsets;
+	for (int32 RecordIndex = 0; bSucceeded && RecordIndex < Records.Num(); ++RecordIndex)
+	{
+		const TPair<uint64, FRecordLocation>& Record = Records[RecordIndex];
+		CompactedOffsets.Add(Record.Key, TempHandle->Tell());
+		bSucceeded = CopyToTempFile(Record.Value.Offset, Record.Value.Size);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+
+	const int64 TailOffset = bSucceeded ? TempHandle->Tell() : 0;
+	const int64 TailSize = FileHandle.IsValid() ? FileHandle->Tell() - SnapshotEnd : 0;
+	if (bSucceeded && TailSize > 0)
+	{
+		bSucceeded = CopyToTempFile(SnapshotEnd, TailSize);
+	}
+
+	ReadHandle.Reset();
+	TempHandle.Reset();
+
+	if (!bSucceeded || !FileHandle.IsValid())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Failed to compact the event spool %s."), *FilePath);
+		PlatformFile.DeleteFile(*TempFilePath);
+		return;
+	}
+
+	FileHandle.Reset();
+	PlatformFile.DeleteFile(*FilePath);
+	PlatformFile.MoveFile(*FilePath, *TempFilePath);
+
+	// Compacted records moved to their copy, the ones appended during the copy moved along with the rest of the tail
+	for (TPair<uint64, FRecordLocation>& Record : LiveRecords)
+	{
+		if (Record.Value.Offset >= SnapshotEnd)
+		{
+			Record.Value.Offset += TailOffset - SnapshotEnd;
+		}
+		else if (const int64* CompactedOffset = CompactedOffsets.Find(Record.Key))
+		{
+			Record.Value.Offset = *CompactedOffset;
+		}
+	}
+
+	// Records acknowledged during the copy were copied anyway, they stay dead in the new file along with their acknowledgements
+	DeadBytes -= SnapshotDeadBytes;
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, true));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("Failed to open the event spool %s. Events will only be kept in memory."), *FilePath);
+	}
+}
+
+void FAptabaseEventSpool::CompactInBackgroundIfNeeded()
+{
+	if (DeadBytes < MinDeadBytesForCompaction || (CompactionTask.IsValid() && !CompactionTask.IsReady()))
+	{
+		return;
+	}
+
+	int64 LiveBytes = 0;
+	for (const TPair<uint64, FRecordLocation>& Record : LiveRecords)
+	{
+		LiveBytes += Record.Value.Size;
+	}
+
+	if (DeadBytes < LiveBytes)
+	{
+		return;
+	}
+
+	CompactionTask = Async(EAsyncExecution::ThreadPool, [this]()
+	{
+		LLM_SCOPE_BYTAG(Aptabase);
+		Compact();
+	});
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Async/Future.h>
+#include <Containers/Array.h>
+#include <Containers/Map.h>
+#include <HAL/CriticalSection.h>
+#include <Templates/SharedPointer.h>
+#include <Templates/UniquePtr.h>
+
+class IFileHandle;
+struct FAptabaseEventBatch;
+struct FAptabaseSpoolRefs;
+
+/**
+ * @brief Append-only, checksummed on-disk log of encoded events that haven't been acknowledged by the backend yet
+ * @note Records are appended without forcing them to the physical disk, which is enough to survive a crash of the process.
+ * A record is acknowledged once every one of its events was released. Acknowledgements are appended as small records and
+ * the file is compacted on a background thread.
+ */
+class FAptabaseEventSpool
+{
+public:
+	explicit FAptabaseEventSpool(const FString& InFilePath);
+	~FAptabaseEventSpool();
+	/**
+	 * @brief Opens the spool for writing
+	 * @return Batches a previous run appended but never acknowledged, already tagged with their spool ids
+	 */
+	TArray<TSharedRef<FAptabaseEventBatch>> Open();
+	/**
+	 * @brief Hands out the id of a record that will be appended later, so events can be tagged with it while they are encoded
+	 */
+	uint64 ReserveId();
+	/**
+	 * @brief Persists the batch body as a record holding Batch.NumEvents events
+	 * @note Assigns a new spool id unless the batch already carries a reserved one
+	 * @return false if the batch couldn't be written
+	 */
+	bool Append(FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Whether the batch was written to the spool and hasn't been acknowledged yet
+	 */
+	bool IsPersisted(const FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Reads back the body of a batch that was appended earlier and released from memory
+	 * @return false if the record is gone or corrupted
+	 */
+	bool Load(FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Releases events from their records, a record whose events were all released won't be replayed
+	 */
+	void Release(const FAptabaseSpoolRefs& SpoolRefs);
+	/**
+	 * @brief Marks the events of the batch as delivered (or discarded) so they won't be replayed
+	 */
+	void Acknowledge(const FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Waits for a pending compaction and closes the file
+	 */
+	void Close();
+
+private:
+	/**
+	 * @brief Location of a record that hasn't been acknowledged yet
+	 */
+	struct FRecordLocation
+	{
+		int64 Offset = 0;
+		int64 Size = 0;
+		/**
+		 * @brief Events of the record not released yet
+		 */
+		int32 NumPendingEvents = 0;
+	};
+	/**
+	 * @brief Writes a record at the end of the file
+	 * @return Offset of the record
+	 */
+	int64 WriteRecord(uint32 Type, uint64 Id, int32 NumEvents, int64 OldestEventTicks, TConstArrayView<uint8> Body);
+	/**
+	 * @brief Rewrites the file with only the records that still need to be delivered
+	 * @note Caller must not hold Lock. The records are copied without it, only the swap of the files blocks appends.
+	 */
+	void Compact();
+	/**
+	 * @brief Schedules Compact on a background thread if enough of the file is made of acknowledged records
+	 * @note Caller must hold Lock
+	 */
+	void CompactInBackgroundIfNeeded();
+	/**
+	 * @brief Path to the spool file
+	 */
+	const FString FilePath;
+	/**
+	 * @brief Guards the file handle and the bookkeeping below, shared with the background compaction
+	 */
+	FCriticalSection Lock;
+	/**
+	 * @brief Handle the records are appended to
+	 */
+	TUniquePtr<IFileHandle> FileHandle;
+	/**
+	 * @brief Records that still need to be delivered, by spool id
+	 */
+	TMap<uint64, FRecordLocation> LiveRecords;
+	/**
+	 * @brief Bytes taken by acknowledged records and acknowledgements, reclaimed by compaction
+	 */
+	int64 DeadBytes = 0;
+	/**
+	 * @brief Id given to the next appended or reserved record
+	 */
+	uint64 NextId = 1;
+	/**
+	 * @brief Background compaction, if one was scheduled
+	 */
+	TFuture<void> CompactionTask;
+};
@@ -0,0 +1,67 @@
+#include "AptabaseFileTransport.h"
+
+#include <GenericPlatform/GenericPlatformFile.h>
+#include <HAL/PlatformFileManager.h>
+#include <Interfaces/IHttpResponse.h>
+#include <Misc/Paths.h>
+#include <Misc/ScopeLock.h>
+
+#include "AptabaseLog.h"
+
+FAptabaseFileTransport::FAptabaseFileTransport(const FString& InFilePath)
+	: FilePath(InFilePath)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, true));
+	if (FileHandle.IsValid())
+	{
+		UE_LOG(LogAptabase, Log, TEXT("Events are written to %s, nothing is sent."), *FilePath);
+	}
+	else
+	{
+		UE_LOG(LogAptabase, Error, TEXT("Failed to open %s. Events will be retried until it can be written."), *FilePath);
+	}
+}
+
+FAptabaseFileTransport::~FAptabaseFileTransport()
+{
+	FScopeLock Lock(&FileLock);
+	if (FileHandle.IsValid())
+	{
+		FileHandle->Flush();
+		FileHandle.Reset();
+	}
+}
+
+double FAptabaseFileTransport::Deliver(const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& OutResponse)
+{
+	// The batches are condensed JSON, so a batch never spans several lines
+	static constexpr uint8 LineFeed = '\n';
+
+	bool bWasWritten = false;
+	{
+		FScopeLock Lock(&FileLock);
+		if (!FileHandle.IsValid())
+		{
+			FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FilePath, true));
+		}
+
+		bWasWritten = FileHandle.IsValid() && FileHandle->Write(Body.GetData(), Body.Num()) && FileHandle->Write(&LineFeed, 1);
+	}
+
+	// Failures look like connection failures, so the batch is retried and stays in the spool
+	if (bWasWritten)
+	{
+		OutResponse.bWasDelivered = true;
+		OutResponse.StatusCode = EHttpResponseCodes::Ok;
+	}
+	else
+	{
+		UE_LOG(LogAptabase, Error, TEXT("Failed to write batch to %s."), *FilePath);
+	}
+
+	// Completes on the next tick rather than from inside Process, like a request would
+	return 0.0;
+}
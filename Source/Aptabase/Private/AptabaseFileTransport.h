@@ -0,0 +1,40 @@
+#pragma once
+
+#include <HAL/CriticalSection.h>
+
+#include "AptabaseTransport.h"
+
+class IFileHandle;
+
+/**
+ * @brief Appends batches to a newline-delimited JSON file instead of sending them, for builds running offline
+ * @note Every line holds the JSON array of one batch. Batches are acknowledged once written, or failed if the file can't be written.
+ */
+class FAptabaseFileTransport final : public FAptabaseLocalTransport
+{
+public:
+	explicit FAptabaseFileTransport(const FString& InFilePath);
+	virtual ~FAptabaseFileTransport() override;
+	// Begin IAptabaseTransport Interface
+	virtual bool SupportsCompression() const override { return false; }
+	// End IAptabaseTransport Interface
+
+protected:
+	// Begin FAptabaseLocalTransport Interface
+	virtual double Deliver(const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& OutResponse) override;
+	// End FAptabaseLocalTransport Interface
+
+private:
+	/**
+	 * @brief Location of the output file
+	 */
+	FString FilePath;
+	/**
+	 * @brief Output file opened for appending, null if it couldn't be opened
+	 */
+	TUniquePtr<IFileHandle> FileHandle;
+	/**
+	 * @brief Guards FileHandle
+	 */
+	FCriticalSection FileLock;
+};
@@ -0,0 +1,75 @@
+#include "AptabaseHttpTransport.h"
+
+#include <HttpManager.h>
+#include <HttpModule.h>
+#include <Interfaces/IHttpResponse.h>
+
+#include "AptabaseSettings.h"
+
+FAptabaseHttpTransport::FAptabaseHttpTransport(bool bInCompleteOnHttpThread)
+	: bCompleteOnHttpThread(bInCompleteOnHttpThread)
+{
+	FHttpModule::Get();
+}
+
+TSharedRef<IAptabaseTransportRequest> FAptabaseHttpTransport::CreateRequest(TArray<uint8>&& Body, bool bCompressed, FOnAptabaseTransportComplete&& OnComplete)
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+
+	const FHttpRequestRef HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetVerb("POST");
+	HttpRequest->SetContent(MoveTemp(Body));
+	if (bCompressed)
+	{
+		HttpRequest->SetHeader(TEXT("Content-Encoding"), TEXT("gzip"));
+	}
+
+	HttpRequest->SetHeader(TEXT("App-Key"), Settings->AppKey);
+	HttpRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
+	HttpRequest->SetURL(FString::Printf(TEXT("%s/api/v0/events"), *Settings->GetApiUrl()));
+	if (bCompleteOnHttpThread)
+	{
+		HttpRequest->SetDelegateThreadPolicy(EHttpRequestDelegateThreadPolicy::CompleteOnHttpThread);
+	}
+
+	HttpRequest->OnProcessRequestComplete().BindLambda([OnComplete = MoveTemp(OnComplete)](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		FAptabaseTransportResponse TransportResponse;
+		if (bWasSuccessful && Response.IsValid())
+		{
+			TransportResponse.bWasDelivered = true;
+			TransportResponse.StatusCode = Response->GetResponseCode();
+			TransportResponse.RetryAfter = Response->GetHeader(TEXT("Retry-After"));
+		}
+
+		OnComplete.ExecuteIfBound(TransportResponse);
+	});
+
+	return MakeShared<FRequest>(HttpRequest);
+}
+
+void FAptabaseHttpTransport::Tick(float DeltaTime)
+{
+	FHttpModule::Get().GetHttpManager().Tick(DeltaTime);
+}
+
+void FAptabaseHttpTransport::FRequest::Process()
+{
+	// Completes right away if the request can't be started, e.g. when the URL is invalid
+	HttpRequest->ProcessRequest();
+}
+
+void FAptabaseHttpTransport::FRequest::Cancel()
+{
+	HttpRequest->CancelRequest();
+}
+
+const TArray<uint8>& FAptabaseHttpTransport::FRequest::GetBody() const
+{
+	return HttpRequest->GetContent();
+}
+
+bool FAptabaseHttpTransport::FRequest::IsCompressed() const
+{
+	return !HttpRequest->GetHeader(TEXT("Content-Encoding")).IsEmpty();
+}
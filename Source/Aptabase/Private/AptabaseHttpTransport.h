@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Interfaces/IHttpRequest.h>
+
+#include "AptabaseTransport.h"
+
+/**
+ * @brief Posts batches to the Aptabase backend configured in the settings
+ */
+class FAptabaseHttpTransport final : public IAptabaseTransport
+{
+public:
+	/**
+	 * @param bInCompleteOnHttpThread Whether completions run on the HTTP thread instead of being deferred to the game thread
+	 * @note The HTTP module is loaded here, so the first request can be created from any thread
+	 */
+	explicit FAptabaseHttpTransport(bool bInCompleteOnHttpThread);
+	// Begin IAptabaseTransport Interface
+	virtual TSharedRef<IAptabaseTransportRequest> CreateRequest(TArray<uint8>&& Body, bool bCompressed, FOnAptabaseTransportComplete&& OnComplete) override;
+	virtual void Tick(float DeltaTime) override;
+	// End IAptabaseTransport Interface
+
+private:
+	/**
+	 * @brief Wraps the HTTP request carrying a batch
+	 */
+	class FRequest final : public IAptabaseTransportRequest
+	{
+	public:
+		explicit FRequest(const FHttpRequestRef& InHttpRequest)
+			: HttpRequest(InHttpRequest)
+		{
+		}
+		// Begin IAptabaseTransportRequest Interface
+		virtual void Process() override;
+		virtual void Cancel() override;
+		virtual const TArray<uint8>& GetBody() const override;
+		virtual bool IsCompressed() const override;
+		// End IAptabaseTransportRequest Interface
+
+	private:
+		FHttpRequestRef HttpRequest;
+	};
+	/**
+	 * @brief Whether completions run on the HTTP thread
+	 */
+	bool bCompleteOnHttpThread = false;
+};
@@ -0,0 +1,23 @@
+#include "AptabaseLoopbackTransport.h"
+
+#include <Interfaces/IHttpResponse.h>
+
+#include "AptabaseSettings.h"
+
+double FAptabaseLoopbackTransport::Deliver(const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& OutResponse)
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+
+	// A single roll decides between a connection failure, an error status and a success, so the rates add up
+	const float Roll = FMath::FRand();
+
+	if (Roll >= Settings->LoopbackFailureRate)
+	{
+		OutResponse.bWasDelivered = true;
+		OutResponse.StatusCode = Roll < Settings->LoopbackFailureRate + Settings->LoopbackErrorRate ? Settings->LoopbackErrorStatusCode : EHttpResponseCodes::Ok;
+	}
+
+	SendDelegate.ExecuteIfBound(Body, bCompressed, OutResponse);
+
+	return Settings->LoopbackLatency;
+}
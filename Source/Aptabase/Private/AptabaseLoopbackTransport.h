@@ -0,0 +1,38 @@
+#pragma once
+
+#include "AptabaseTransport.h"
+
+/**
+ * @brief Called with every batch a loopback transport receives and the response it is about to send back
+ * @note Runs on the pipeline thread, so tests can look at the bodies and inject status codes
+ */
+DECLARE_DELEGATE_ThreeParams(FOnAptabaseLoopbackSend, const TArray<uint8>& /* Body */, bool /* bCompressed */, FAptabaseTransportResponse& /* InOutResponse */);
+
+/**
+ * @brief Acknowledges batches in-process without sending them anywhere, for load tests and soak runs
+ * @note Latency, connection failures and error status codes are injected following the Loopback settings, so retries and
+ * backoff run as they would against the backend
+ */
+class FAptabaseLoopbackTransport final : public FAptabaseLocalTransport
+{
+public:
+	/**
+	 * @brief Hook of this transport, unbound unless a test binds it before handing the transport over to a provider
+	 */
+	FOnAptabaseLoopbackSend& OnSend() { return SendDelegate; }
+	/**
+	 * @brief Completes requests from inside Process, ignoring LoopbackLatency
+	 */
+	void SetCompleteInline(bool bInCompleteInline) { bCompleteInline = bInCompleteInline; }
+
+protected:
+	// Begin FAptabaseLocalTransport Interface
+	virtual double Deliver(const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& OutResponse) override;
+	// End FAptabaseLocalTransport Interface
+
+private:
+	/**
+	 * @brief Called with every body delivered
+	 */
+	FOnAptabaseLoopbackSend SendDelegate;
+};
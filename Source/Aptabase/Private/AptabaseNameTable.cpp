@@ -0,0 +1,92 @@
+#include "AptabaseNameTable.h"
+
+#include <Misc/ScopeRWLock.h>
+
+#include "AptabaseLog.h"
+
+thread_local FAptabaseNameTable::FNameMap FAptabaseNameTable::ThreadNames;
+
+FAptabaseNameTable& FAptabaseNameTable::Get()
+{
+	static FAptabaseNameTable NameTable;
+	return NameTable;
+}
+
+FAptabaseNameTable::FAptabaseNameTable()
+{
+	// Index 0 is the empty string, which default constructed handles refer to
+	Chunks[0] = new FEntry[EntriesPerChunk];
+	Names.Add(FString(), FAptabaseName());
+	CaseInsensitiveNames.Add(FString(), FAptabaseName());
+	NumEntries = 1;
+}
+
+FAptabaseNameTable::~FAptabaseNameTable()
+{
+	for (FEntry* Chunk : Chunks)
+	{
+		delete[] Chunk;
+	}
+}
+
+FAptabaseName FAptabaseNameTable::Intern(const FString& String)
+{
+	if (const FAptabaseName* Name = ThreadNames.Find(String))
+	{
+		return *Name;
+	}
+
+	// Invalid handles aren't kept, names that didn't fit could grow the cache without bound
+	const FAptabaseName Name = InternShared(String);
+	if (Name.IsValid())
+	{
+		ThreadNames.Add(String, Name);
+	}
+
+	return Name;
+}
+
+FAptabaseName FAptabaseNameTable::InternShared(const FString& String)
+{
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const FAptabaseName* Name = Names.Find(String))
+		{
+			return *Name;
+		}
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+
+	// Another thread may have added it between the two locks
+	if (const FAptabaseName* Name = Names.Find(String))
+	{
+		return *Name;
+	}
+
+	if (NumEntries == EntriesPerChunk * MaxChunks)
+	{
+		if (!bReportedFull)
+		{
+			UE_LOG(LogAptabase, Error, TEXT("Too many distinct event names and attribute keys (%u). Events using new ones, starting with \"%s\", are dropped."), NumEntries, *String);
+			bReportedFull = true;
+		}
+		return FAptabaseName{FAptabaseName::InvalidIndex};
+	}
+
+	const FAptabaseName Name{NumEntries};
+	FEntry*& Chunk = Chunks[Name.Index / EntriesPerChunk];
+	if (!Chunk)
+	{
+		Chunk = new FEntry[EntriesPerChunk];
+	}
+
+	FEntry& Entry = Chunk[Name.Index % EntriesPerChunk];
+	Entry.String = String;
+	Entry.CaseInsensitiveName = CaseInsensitiveNames.FindOrAdd(String, Name);
+
+	Names.Add(String, Name);
+	++NumEntries;
+
+	return Name;
+}
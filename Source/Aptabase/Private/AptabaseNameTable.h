@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Containers/Map.h>
+#include <Containers/UnrealString.h>
+#include <HAL/CriticalSection.h>
+#include <Misc/Crc.h>
+
+/**
+ * @brief Compact handle to a string interned in FAptabaseNameTable
+ * @note The default handle refers to the empty string
+ */
+struct FAptabaseName
+{
+	/**
+	 * @brief Index of the handle returned by Intern once the name table is full
+	 */
+	static constexpr uint32 InvalidIndex = MAX_uint32;
+
+	/**
+	 * @brief Position of the string in the name table
+	 */
+	uint32 Index = 0;
+
+	/**
+	 * @brief Whether the handle refers to an interned string. Invalid handles must not be resolved.
+	 */
+	bool IsValid() const { return Index != InvalidIndex; }
+	bool operator==(FAptabaseName Other) const { return Index == Other.Index; }
+	bool operator!=(FAptabaseName Other) const { return Index != Other.Index; }
+	friend uint32 GetTypeHash(FAptabaseName Name) { return Name.Index; }
+};
+
+/**
+ * @brief Process-wide table of event names and attribute keys, so each distinct string is stored only once
+ * @note Interning is thread-safe. Entries are never removed or moved, so resolving a handle doesn't take any lock, and neither does
+ * interning a string the calling thread already interned.
+ */
+class FAptabaseNameTable
+{
+public:
+	/**
+	 * @brief Interned string and the data derived from it
+	 */
+	struct FEntry
+	{
+		/**
+		 * @brief The string, as it was first interned
+		 */
+		FString String;
+		/**
+		 * @brief First interned string equal to this one ignoring case, which JSON objects treat as the same key
+		 */
+		FAptabaseName CaseInsensitiveName;
+	};
+
+	static FAptabaseNameTable& Get();
+	~FAptabaseNameTable();
+	/**
+	 * @brief Finds or adds the string, case-sensitive
+	 * @return An invalid handle if the string is new and the table is full
+	 */
+	FAptabaseName Intern(const FString& String);
+	/**
+	 * @brief Entry of a handle returned by Intern
+	 */
+	const FEntry& Resolve(FAptabaseName Name) const
+	{
+		return Chunks[Name.Index / EntriesPerChunk][Name.Index % EntriesPerChunk];
+	}
+
+private:
+	FAptabaseNameTable();
+	/**
+	 * @brief Case-sensitive string keys, the default FString key funcs ignore case
+	 */
+	struct FCaseSensitiveKeyFuncs : BaseKeyFuncs<TPair<FString, FAptabaseName>, FString, false>
+	{
+		static const FString& GetSetKey(const TPair<FString, FAptabaseName>& Element) { return Element.Key; }
+		static bool Matches(const FString& A, const FString& B) { return A.Equals(B, ESearchCase::CaseSensitive); }
+		static uint32 GetKeyHash(const FString& Key) { return FCrc::StrCrc32(*Key); }
+	};
+
+	// Entries are never removed, the cap bounds what dynamically built names can take for the life of the process
+	static constexpr uint32 EntriesPerChunk = 1024;
+	static constexpr uint32 MaxChunks = 64;
+	using FNameMap = TMap<FString, FAptabaseName, FDefaultSetAllocator, FCaseSensitiveKeyFuncs>;
+	/**
+	 * @brief Looks the string up in the shared maps and adds it if it is new
+	 */
+	FAptabaseName InternShared(const FString& String);
+	/**
+	 * @brief Handles the calling thread already got from Intern, so producers only take the lock the first time they use a name
+	 * @note A handle never changes once interned, so the copies never go stale
+	 */
+	static thread_local FNameMap ThreadNames;
+	/**
+	 * @brief Guards the lookup maps and the addition of new entries
+	 */
+	FRWLock Lock;
+	/**
+	 * @brief Handle of every interned string
+	 */
+	FNameMap Names;
+	/**
+	 * @brief Handle of the first interned spelling of every string, ignoring case
+	 */
+	TMap<FString, FAptabaseName> CaseInsensitiveNames;
+	/**
+	 * @brief Fixed-size blocks of entries, allocated as the table grows
+	 */
+	FEntry* Chunks[MaxChunks] = {};
+	/**
+	 * @brief Number of entries in use
+	 */
+	uint32 NumEntries = 0;
+	/**
+	 * @brief Set once the table filled up, so it is only reported once
+	 */
+	bool bReportedFull = false;
+};
@@ -0,0 +1,13 @@
+#include "AptabaseReadEpochs.h"
+
+#include <HAL/PlatformProcess.h>
+
+void FAptabaseReadEpochs::WaitForReaders()
+{
+	// Readers entering from now on load the pointer after the swap, only the ones of the previous epoch may hold the old one
+	const uint32 PreviousEpoch = CurrentEpoch++;
+	while (NumReaders[PreviousEpoch & 1].load(std::memory_order_acquire) != 0)
+	{
+		FPlatformProcess::Yield();
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <CoreTypes.h>
+#include <Misc/AssertionMacros.h>
+
+#include <atomic>
+
+/**
+ * @brief Tracks the readers of data published through an atomic pointer, so a writer knows when the version it replaced can be freed
+ * @note Readers never block, they only retry when a writer moves to the next epoch at the same time. Writers must be serialized by the owner.
+ */
+class FAptabaseReadEpochs
+{
+public:
+	/**
+	 * @brief Keeps whatever pointer is loaded while in scope alive
+	 */
+	class FReadScope
+	{
+	public:
+		explicit FReadScope(const FAptabaseReadEpochs& InEpochs)
+			: Epochs(InEpochs)
+		{
+			// Counted in the epoch it is in, a writer that moved on in the meantime might not see the count anymore
+			while (true)
+			{
+				Epoch = Epochs.CurrentEpoch.load();
+				++Epochs.NumReaders[Epoch & 1];
+				if (Epochs.CurrentEpoch.load() == Epoch)
+				{
+					break;
+				}
+				--Epochs.NumReaders[Epoch & 1];
+			}
+		}
+
+		~FReadScope()
+		{
+			Epochs.NumReaders[Epoch & 1].fetch_sub(1, std::memory_order_release);
+		}
+
+		UE_NONCOPYABLE(FReadScope);
+
+	private:
+		const FAptabaseReadEpochs& Epochs;
+		uint32 Epoch = 0;
+	};
+
+	/**
+	 * @brief Blocks until no reader can still hold a pointer unpublished before this call
+	 * @note Writer only, after swapping the pointer. Readers only stay in scope for a lookup, so the wait is short.
+	 */
+	void WaitForReaders();
+
+private:
+	/**
+	 * @brief Incremented by every wait, its parity selects the reader count new readers go to
+	 */
+	mutable std::atomic<uint32> CurrentEpoch = 0;
+	/**
+	 * @brief Readers in scope, per parity of the epoch they entered in
+	 */
+	mutable std::atomic<int32> NumReaders[2] = {};
+};
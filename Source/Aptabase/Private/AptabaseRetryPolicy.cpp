@@ -0,0 +1,53 @@
+#include "AptabaseRetryPolicy.h"
+
+#include "AptabaseData.h"
+#include "AptabaseSettings.h"
+
+bool FAptabaseRetryPolicy::ScheduleRetry(FAptabaseEventBatch& Batch, double Now, TOptional<double> RetryAfter)
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+
+	if (Batch.NumAttempts > Settings->MaxRetryAttempts || IsExpired(Batch))
+	{
+		return false;
+	}
+
+	// Equal jitter: wait at least half of the exponential delay, so retries are spread out but still back off
+	const double ExponentialDelay = FMath::Min<double>(Settings->RetryMaxDelay, Settings->RetryInitialDelay * FMath::Pow(2.0, Batch.NumAttempts - 1));
+	const double JitteredDelay = FMath::FRandRange(ExponentialDelay * 0.5, ExponentialDelay);
+
+	Batch.NextAttemptTime = Now + FMath::Max(JitteredDelay, RetryAfter.Get(0.0));
+	return true;
+}
+
+bool FAptabaseRetryPolicy::IsExpired(const FAptabaseEventBatch& Batch)
+{
+	// Wall-clock time, the batch may have been written to the spool by a previous run
+	return (FDateTime::UtcNow() - Batch.OldestEventTime).GetTotalSeconds() > GetDefault<UAptabaseSettings>()->MaxEventAge;
+}
+
+TOptional<double> FAptabaseRetryPolicy::ParseRetryAfter(const FString& HeaderValue)
+{
+	const FString TrimmedValue = HeaderValue.TrimStartAndEnd();
+	if (TrimmedValue.IsEmpty())
+	{
+		return {};
+	}
+
+	double Delay = 0.0;
+	FDateTime RetryDate;
+	if (TrimmedValue.IsNumeric())
+	{
+		Delay = FCString::Atod(*TrimmedValue);
+	}
+	else if (FDateTime::ParseHttpDate(TrimmedValue, RetryDate))
+	{
+		Delay = (RetryDate - FDateTime::UtcNow()).GetTotalSeconds();
+	}
+	else
+	{
+		return {};
+	}
+
+	return FMath::Clamp(Delay, 0.0, static_cast<double>(GetDefault<UAptabaseSettings>()->MaxRetryAfter));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Containers/UnrealString.h>
+#include <Misc/Optional.h>
+
+struct FAptabaseEventBatch;
+
+/**
+ * @brief Decides when, and whether, a failed batch gets another attempt
+ * @note Exponential backoff with jitter so clients that failed at the same time don't all come back at the same time
+ */
+class FAptabaseRetryPolicy
+{
+public:
+	/**
+	 * @brief Updates the batch for its next attempt
+	 * @param Now Current time, from FPlatformTime::Seconds
+	 * @param RetryAfter Delay requested by the backend, if any
+	 * @return false when the batch exhausted its attempts or got too old and must be discarded
+	 */
+	static bool ScheduleRetry(FAptabaseEventBatch& Batch, double Now, TOptional<double> RetryAfter);
+	/**
+	 * @brief Whether the oldest event of the batch is older than MaxEventAge, in which case it isn't worth sending anymore
+	 */
+	static bool IsExpired(const FAptabaseEventBatch& Batch);
+	/**
+	 * @brief Parses a Retry-After header, either in delay-seconds or HTTP-date form
+	 * @return Delay in seconds clamped to MaxRetryAfter, unset if the header is missing or malformed
+	 */
+	static TOptional<double> ParseRetryAfter(const FString& HeaderValue);
+};
@@ -1,5 +1,7 @@
 ﻿#include "AptabaseSettings.h"
 
+#include <Misc/Paths.h>
+
 FString UAptabaseSettings::GetApiUrl() const
 {
 	switch (Host)
@@ -17,6 +19,16 @@ FString UAptabaseSettings::GetApiUrl() const
 	}
 }
 
+FString UAptabaseSettings::GetFileTransportPath() const
+{
+	if (FileTransportPath.IsEmpty())
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Aptabase"), TEXT("Events.ndjson"));
+	}
+
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), FileTransportPath);
+}
+
 FName UAptabaseSettings::GetContainerName() const
 {
 	return TEXT("Project");
@@ -32,6 +44,13 @@ FName UAptabaseSettings::GetSectionName() const
 	return TEXT("Aptabase");
 }
 
+void UAptabaseSettings::PostReloadConfig(FProperty* PropertyThatWasLoaded)
+{
+	Super::PostReloadConfig(PropertyThatWasLoaded);
+
+	OnSamplingRulesChanged.Broadcast();
+}
+
 #if WITH_EDITOR
 FText UAptabaseSettings::GetSectionText() const
 {
@@ -60,5 +79,10 @@ void UAptabaseSettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyCh
 
 		SaveConfig(CPF_Config, *GetDefaultConfigFilename());
 	}
+
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UAptabaseSettings, SamplingRules))
+	{
+		OnSamplingRulesChanged.Broadcast();
+	}
 }
 #endif
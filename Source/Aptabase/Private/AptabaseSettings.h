@@ -16,6 +16,90 @@ enum class EAptabaseHost : uint8
 	SH
 };
 
+/**
+ * @brief What happens to new events once the event queue reached its budget
+ */
+UENUM()
+enum class EAptabaseOverflowPolicy : uint8
+{
+	/** Discard the oldest queued events to make room */
+	DropOldest,
+	/** Discard the events that don't fit anymore. Batches already encoded are never dropped, new events are rejected until they are delivered. */
+	DropNewest,
+	/** Discard the least important events first, oldest first within the same priority */
+	DropLowestPriority,
+	/** Move the oldest events to the on-disk spool and send them once the queue has room again. Drops the oldest events if persistence is disabled. */
+	SpillToDisk
+};
+
+/**
+ * @brief Where encoded batches are delivered
+ */
+UENUM()
+enum class EAptabaseTransport : uint8
+{
+	/** Send them to the Aptabase backend of the Host */
+	Http,
+	/** Acknowledge them in-process after the loopback latency, without sending anything. Meant for load tests. */
+	Loopback,
+	/** Append them to a newline-delimited JSON file, for builds running offline */
+	File
+};
+
+/**
+ * @brief Event folded into one summary event per time window instead of being sent every time it is recorded
+ */
+USTRUCT()
+struct FAptabaseAggregationRule
+{
+	GENERATED_BODY()
+
+	/**
+	 * @brief Name of the event to aggregate
+	 */
+	UPROPERTY(EditAnywhere, Category = "Aptabase Analytics")
+	FString EventName;
+
+	/**
+	 * @brief How long occurrences are collected before their summary is sent
+	 * @note in seconds
+	 */
+	UPROPERTY(EditAnywhere, Category = "Aptabase Analytics", meta = (Unit = "s", ClampMin = "0.1"))
+	float Window = 10.0f;
+};
+
+/**
+ * @brief Sampling and rate limit applied to events as they are recorded
+ */
+USTRUCT()
+struct FAptabaseSamplingRule
+{
+	GENERATED_BODY()
+
+	/**
+	 * @brief Name of the events the rule applies to, * and ? wildcards are allowed (e.g. "ui_*")
+	 */
+	UPROPERTY(EditAnywhere, Category = "Aptabase Analytics")
+	FString EventName;
+
+	/**
+	 * @brief Fraction of the sessions that send these events. Every session decides once, and kept events get a "sample_weight" property of 1 / SampleRate.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Aptabase Analytics", meta = (ClampMin = "0", ClampMax = "1"))
+	float SampleRate = 1.0f;
+
+	/**
+	 * @brief Sustained number of these events kept per second, the others are dropped. 0 doesn't limit them.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Aptabase Analytics", meta = (ClampMin = "0"))
+	float MaxEventsPerSecond = 0.0f;
+
+	/**
+	 * @brief Number of these events that can be recorded at once before MaxEventsPerSecond applies
+	 */
+	UPROPERTY(EditAnywhere, Category = "Aptabase Analytics", meta = (EditCondition = "MaxEventsPerSecond > 0", ClampMin = "1"))
+	int32 Burst = 10;
+};
 
 /**
  * Holds configuration for integrating the Aptabase Analytics tracker
@@ -29,6 +113,10 @@ public:
 	 * @brief Returns the base Url for all requests we will be sending out based on the Host
 	 */
 	FString GetApiUrl() const;
+	/**
+	 * @brief Returns the file written by the File transport, Saved/Aptabase/Events.ndjson unless FileTransportPath is set
+	 */
+	FString GetFileTransportPath() const;
 	/**
 	 * @brief Key used to identify your app when making requests
 	 */
@@ -45,23 +133,179 @@ public:
 	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics", meta = (EditCondition = "Host == EAptabaseHost::SH", EditConditionHides))
 	FString CustomHost;
 	/**
-	 * @brief How often the analytics provider will send the currently batched events to the backend
-	 * @note in seconds
+	 * @brief Longest time a recorded event waits before the batched events are sent to the backend
+	 * @note in seconds. Nothing is scheduled while no events are waiting.
 	 */
 	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics", meta = (Unit = "s"))
 	float SendInterval = 60.0f;
 	/**
-	 * @brief **DEBUG MODE**: How often the analytics provider will send the currently batched events to the backend
+	 * @brief **DEBUG MODE**: Longest time a recorded event waits before the batched events are sent to the backend
 	 * @note in seconds
 	 */
 	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics", meta = (Unit = "s"))
 	float DebugSendInterval = 2.0f;
+	/**
+	 * @brief Number of waiting events that triggers a flush on the next tick, without waiting for the send interval
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics", meta = (ClampMin = "1"))
+	int32 FlushEventThreshold = 100;
+	/**
+	 * @brief Longest time a Critical event waits before it is sent, whatever the send interval
+	 * @note in seconds. Its batches go ahead of the other waiting batches and are the last ones dropped when the queue is full.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics", meta = (Unit = "s", ClampMin = "0"))
+	float CriticalSendInterval = 1.0f;
+	/**
+	 * @brief Whether batches are gzip compressed before being uploaded
+	 * @note Falls back to uncompressed bodies for the rest of the run if the backend rejects a compressed one
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network")
+	bool bCompressRequests = false;
+	/**
+	 * @brief Size an encoded batch is filled up to before a new one is started. A batch never holds more than 25 events.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (Unit = "Bytes", ClampMin = "1024"))
+	int32 TargetBatchBytes = 32 * 1024;
+	/**
+	 * @brief How many requests can be sent at once. Further batches wait for earlier requests to complete.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (ClampMin = "1"))
+	int32 MaxConcurrentRequests = 2;
+	/**
+	 * @brief Smallest encoded batch size that gets compressed. Smaller bodies are sent as-is.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (EditCondition = "bCompressRequests", Unit = "Bytes", ClampMin = "0"))
+	int32 CompressionThreshold = 1024;
+	/**
+	 * @brief Where batches are delivered. Loopback and File exercise the whole pipeline without any network.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (ConfigRestartRequired = true))
+	EAptabaseTransport Transport = EAptabaseTransport::Http;
+	/**
+	 * @brief How long the loopback transport takes to acknowledge a batch
+	 * @note in seconds
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (EditCondition = "Transport == EAptabaseTransport::Loopback", EditConditionHides, Unit = "s", ClampMin = "0"))
+	float LoopbackLatency = 0.05f;
+	/**
+	 * @brief Share of the loopback requests failing as if the connection was lost
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (EditCondition = "Transport == EAptabaseTransport::Loopback", EditConditionHides, ClampMin = "0", ClampMax = "1"))
+	float LoopbackFailureRate = 0.0f;
+	/**
+	 * @brief Share of the loopback requests answered with LoopbackErrorStatusCode
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (EditCondition = "Transport == EAptabaseTransport::Loopback", EditConditionHides, ClampMin = "0", ClampMax = "1"))
+	float LoopbackErrorRate = 0.0f;
+	/**
+	 * @brief Status code of the loopback requests picked by LoopbackErrorRate (e.g. 429, 503 or 400)
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (EditCondition = "Transport == EAptabaseTransport::Loopback", EditConditionHides, ClampMin = "100", ClampMax = "599"))
+	int32 LoopbackErrorStatusCode = 503;
+	/**
+	 * @brief File the File transport appends batches to, relative to the project directory. Saved/Aptabase/Events.ndjson if empty.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Network", meta = (EditCondition = "Transport == EAptabaseTransport::File", EditConditionHides))
+	FString FileTransportPath;
+	/**
+	 * @brief Whether events are kept in a spool file under Saved/Aptabase from the moment they are recorded until the backend acknowledges them
+	 * @note Events left over by a crash or an unfinished shutdown are sent when the next session starts. Delivery is at-least-once,
+	 * a crash may send some events twice. Off by default: the spool file is shared by every process running from the same project
+	 * directory, so only enable it where one instance runs at a time.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Persistence")
+	bool bPersistEvents = false;
+	/**
+	 * @brief Longest time a recorded event stays in memory only, before it is written to the spool. Independent of SendInterval.
+	 * @note in seconds
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Persistence", meta = (Unit = "s", ClampMin = "0", EditCondition = "bPersistEvents"))
+	float PersistInterval = 1.0f;
+	/**
+	 * @brief How long shutdown waits for the last requests to complete. Batches still undelivered by then stay in the spool.
+	 * @note in seconds, 0 doesn't wait at all
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Persistence", meta = (Unit = "s", ClampMin = "0"))
+	float ShutdownDrainTimeout = 2.0f;
+	/**
+	 * @brief Delay before the first retry of a failed batch. Doubles with every further attempt, with random jitter.
+	 * @note in seconds
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Retry", meta = (Unit = "s", ClampMin = "0.1"))
+	float RetryInitialDelay = 2.0f;
+	/**
+	 * @brief Upper bound of the exponential backoff between two attempts. A longer Retry-After from the backend is still honored, up to MaxRetryAfter.
+	 * @note in seconds
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Retry", meta = (Unit = "s", ClampMin = "0.1"))
+	float RetryMaxDelay = 300.0f;
+	/**
+	 * @brief Longest Retry-After from the backend that is honored. Nothing is sent while it runs, so a bogus header can't hold the events back for the rest of the run.
+	 * @note in seconds
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Retry", meta = (Unit = "s", ClampMin = "0"))
+	float MaxRetryAfter = 3600.0f;
+	/**
+	 * @brief How many times a batch is retried before it is discarded
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Retry", meta = (ClampMin = "0"))
+	int32 MaxRetryAttempts = 10;
+	/**
+	 * @brief Batches whose oldest event is older than this are discarded instead of being retried again, including batches replayed from the spool
+	 * @note in seconds, measured against the UTC time of the event
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Retry", meta = (Unit = "s", ClampMin = "1"))
+	float MaxEventAge = 86400.0f;
+	/**
+	 * @brief Maximum number of events kept in memory while waiting to be sent, including batches waiting for a retry
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Queue", meta = (ClampMin = "1"))
+	int32 MaxQueuedEvents = 10000;
+	/**
+	 * @brief Maximum memory taken by events waiting to be sent, including batches waiting for a retry
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Queue", meta = (Unit = "Bytes", ClampMin = "1024"))
+	int32 MaxQueuedBytes = 4 * 1024 * 1024;
+	/**
+	 * @brief What to do with events recorded while the queue is full
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Queue")
+	EAptabaseOverflowPolicy OverflowPolicy = EAptabaseOverflowPolicy::DropOldest;
+	/**
+	 * @brief Events summarized on the client. Occurrences sharing the same string attributes are sent once per window
+	 * with a "count" property and the sum, min and max of every numeric attribute (e.g. "damage_sum").
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Aggregation")
+	TArray<FAptabaseAggregationRule> AggregatedEvents;
+	/**
+	 * @brief Rules dropping a share of some events before they are queued, to contain runaway events without shipping a patch
+	 * @note Applied again when the config is reloaded (e.g. by a hotfix) or edited
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Sampling")
+	TArray<FAptabaseSamplingRule> SamplingRules;
+	/**
+	 * @brief Broadcast on the game thread whenever SamplingRules changes at runtime
+	 */
+	FSimpleMulticastDelegate OnSamplingRulesChanged;
+	/**
+	 * @brief Whether batching, encoding, compression and request handling run on a dedicated low-priority thread instead of the game thread
+	 * @note Recording events stays the same, the game thread only hands them over
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Performance", meta = (ConfigRestartRequired = true))
+	bool bUseBackgroundWorker = false;
+	/**
+	 * @brief Game thread time a flush may take per frame. Once it runs out, the remaining events are encoded and sent on the next frames.
+	 * @note in milliseconds, 0 for no limit. Each slice encodes at least one batch. Ignored with bUseBackgroundWorker and for the last flush of a session.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Aptabase Analytics|Performance", meta = (Unit = "ms", ClampMin = "0"))
+	float FlushTimeBudgetMs = 0.0f;
 
 private:
 	// Begin UDeveloperSettings interface
 	virtual FName GetContainerName() const override;
 	virtual FName GetCategoryName() const override;
 	virtual FName GetSectionName() const override;
+	virtual void PostReloadConfig(FProperty* PropertyThatWasLoaded) override;
 #if WITH_EDITOR
 	virtual FText GetSectionText() const override;
 	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
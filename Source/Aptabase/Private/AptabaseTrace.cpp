@@ -0,0 +1,65 @@
+#include "AptabaseTrace.h"
+
+#include <HAL/PlatformTime.h>
+
+LLM_DEFINE_TAG(Aptabase);
+
+UE_TRACE_CHANNEL_DEFINE(AptabaseChannel);
+
+#if UE_TRACE_ENABLED
+
+UE_TRACE_EVENT_BEGIN(Aptabase, Flush)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int32, NumEvents)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Aptabase, BatchSent)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, BatchId)
+	UE_TRACE_EVENT_FIELD(int32, NumEvents)
+	UE_TRACE_EVENT_FIELD(int32, NumBytes)
+	UE_TRACE_EVENT_FIELD(int32, Attempt)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Aptabase, BatchCompleted)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, BatchId)
+	UE_TRACE_EVENT_FIELD(int32, NumEvents)
+	UE_TRACE_EVENT_FIELD(int32, StatusCode)
+	UE_TRACE_EVENT_FIELD(double, LatencyMs)
+UE_TRACE_EVENT_END()
+
+#endif
+
+void AptabaseTrace::OutputFlush(int32 NumEvents)
+{
+#if UE_TRACE_ENABLED
+	UE_TRACE_LOG(Aptabase, Flush, AptabaseChannel)
+		<< Flush.Cycle(FPlatformTime::Cycles64())
+		<< Flush.NumEvents(NumEvents);
+#endif
+}
+
+void AptabaseTrace::OutputBatchSent(uint64 BatchId, int32 NumEvents, int32 NumBytes, int32 Attempt)
+{
+#if UE_TRACE_ENABLED
+	UE_TRACE_LOG(Aptabase, BatchSent, AptabaseChannel)
+		<< BatchSent.Cycle(FPlatformTime::Cycles64())
+		<< BatchSent.BatchId(BatchId)
+		<< BatchSent.NumEvents(NumEvents)
+		<< BatchSent.NumBytes(NumBytes)
+		<< BatchSent.Attempt(Attempt);
+#endif
+}
+
+void AptabaseTrace::OutputBatchCompleted(uint64 BatchId, int32 NumEvents, int32 StatusCode, double LatencySeconds)
+{
+#if UE_TRACE_ENABLED
+	UE_TRACE_LOG(Aptabase, BatchCompleted, AptabaseChannel)
+		<< BatchCompleted.Cycle(FPlatformTime::Cycles64())
+		<< BatchCompleted.BatchId(BatchId)
+		<< BatchCompleted.NumEvents(NumEvents)
+		<< BatchCompleted.StatusCode(StatusCode)
+		<< BatchCompleted.LatencyMs(LatencySeconds * 1000.0);
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <HAL/LowLevelMemTracker.h>
+#include <ProfilingDebugging/CpuProfilerTrace.h>
+#include <Trace/Trace.h>
+
+/**
+ * @brief Low-level memory tracker tag for every allocation made by the module, shown as "Aptabase" in LLM captures
+ */
+LLM_DECLARE_TAG(Aptabase);
+
+/**
+ * @brief Unreal Insights channel of the module's CPU scopes and events, enabled with -trace=cpu,aptabase
+ */
+UE_TRACE_CHANNEL_EXTERN(AptabaseChannel);
+
+/**
+ * @brief CPU scope only recorded while AptabaseChannel is enabled
+ */
+#define APTABASE_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, AptabaseChannel)
+
+/**
+ * @brief Events of AptabaseChannel, no-ops while the channel is disabled
+ */
+namespace AptabaseTrace
+{
+	/**
+	 * @brief Marks a flush and how many events it encodes
+	 */
+	void OutputFlush(int32 NumEvents);
+	/**
+	 * @brief A batch was handed over to the transport
+	 * @param BatchId Identifies the batch until it completes, the same id is passed to OutputBatchCompleted
+	 */
+	void OutputBatchSent(uint64 BatchId, int32 NumEvents, int32 NumBytes, int32 Attempt);
+	/**
+	 * @brief A batch was acknowledged or failed, StatusCode is 0 if it never reached the receiving end
+	 */
+	void OutputBatchCompleted(uint64 BatchId, int32 NumEvents, int32 StatusCode, double LatencySeconds);
+}
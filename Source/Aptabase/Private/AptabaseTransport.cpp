@@ -0,0 +1,115 @@
+#include "AptabaseTransport.h"
+
+#include <HAL/PlatformTime.h>
+#include <Misc/ScopeLock.h>
+
+#include "AptabaseFileTransport.h"
+#include "AptabaseHttpTransport.h"
+#include "AptabaseLoopbackTransport.h"
+#include "AptabaseLog.h"
+#include "AptabaseSettings.h"
+#include "AptabaseTrace.h"
+
+TUniquePtr<IAptabaseTransport> IAptabaseTransport::Create(bool bCompleteOnAnyThread)
+{
+	const UAptabaseSettings* Settings = GetDefault<UAptabaseSettings>();
+
+	switch (Settings->Transport)
+	{
+	case EAptabaseTransport::Loopback:
+		UE_LOG(LogAptabase, Log, TEXT("Events are acknowledged in-process by the loopback transport, nothing is sent."));
+		return MakeUnique<FAptabaseLoopbackTransport>();
+	case EAptabaseTransport::File:
+		return MakeUnique<FAptabaseFileTransport>(Settings->GetFileTransportPath());
+	case EAptabaseTransport::Http:
+	default:
+		return MakeUnique<FAptabaseHttpTransport>(bCompleteOnAnyThread);
+	}
+}
+
+FAptabaseLocalTransport::~FAptabaseLocalTransport()
+{
+	FScopeLock Lock(&PendingCompletionsLock);
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::RemoveTicker(TickerHandle);
+	}
+}
+
+TSharedRef<IAptabaseTransportRequest> FAptabaseLocalTransport::CreateRequest(TArray<uint8>&& Body, bool bCompressed, FOnAptabaseTransportComplete&& OnComplete)
+{
+	return MakeShared<FRequest>(*this, MoveTemp(Body), bCompressed, MoveTemp(OnComplete));
+}
+
+void FAptabaseLocalTransport::Tick(float DeltaTime)
+{
+	OnTick(DeltaTime);
+}
+
+void FAptabaseLocalTransport::ProcessRequest(const TSharedRef<FRequest>& Request)
+{
+	FAptabaseTransportResponse Response;
+	const double Delay = Deliver(Request->Body, Request->bCompressed, Response);
+
+	if (bCompleteInline)
+	{
+		CompleteRequest(*Request, Response);
+		return;
+	}
+
+	FScopeLock Lock(&PendingCompletionsLock);
+	PendingCompletions.Add({Request, Response, FPlatformTime::Seconds() + Delay});
+
+	// Idle transports don't tick, the first pending completion brings the ticker back
+	if (!TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FAptabaseLocalTransport::OnTick));
+	}
+}
+
+void FAptabaseLocalTransport::CompleteRequest(FRequest& Request, const FAptabaseTransportResponse& Response)
+{
+	// Moved out, the completion holds on to the batch and must not run twice
+	const FOnAptabaseTransportComplete OnComplete = MoveTemp(Request.OnComplete);
+	if (!Request.bCancelled)
+	{
+		OnComplete.ExecuteIfBound(Response);
+	}
+}
+
+bool FAptabaseLocalTransport::OnTick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(Aptabase);
+
+	const double Now = FPlatformTime::Seconds();
+
+	TArray<FPendingCompletion> DueCompletions;
+	bool bHasPendingCompletions = true;
+	{
+		FScopeLock Lock(&PendingCompletionsLock);
+		for (int32 CompletionIndex = 0; CompletionIndex < PendingCompletions.Num(); ++CompletionIndex)
+		{
+			if (PendingCompletions[CompletionIndex].DueTime <= Now)
+			{
+				DueCompletions.Add(MoveTemp(PendingCompletions[CompletionIndex]));
+				PendingCompletions.RemoveAt(CompletionIndex--, EAllowShrinking::No);
+			}
+		}
+
+		// Removed under the lock, so a completion queued in the meantime registers a new ticker
+		if (PendingCompletions.IsEmpty() && TickerHandle.IsValid())
+		{
+			FTSTicker::RemoveTicker(TickerHandle);
+			TickerHandle.Reset();
+			bHasPendingCompletions = false;
+		}
+	}
+
+	// Completions run outside of the lock, they may send the next batch right away
+	for (FPendingCompletion& Completion : DueCompletions)
+	{
+		CompleteRequest(*Completion.Request, Completion.Response);
+	}
+
+	return bHasPendingCompletions;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <Containers/Array.h>
+#include <Containers/Ticker.h>
+#include <Containers/UnrealString.h>
+#include <Delegates/Delegate.h>
+#include <HAL/CriticalSection.h>
+#include <Templates/SharedPointer.h>
+#include <Templates/UniquePtr.h>
+
+#include <atomic>
+
+/**
+ * @brief Outcome of sending a batch through a transport
+ */
+struct FAptabaseTransportResponse
+{
+	/**
+	 * @brief Whether the batch reached the receiving end and got a status code back, false for connection failures and cancelled requests
+	 */
+	bool bWasDelivered = false;
+
+	/**
+	 * @brief HTTP status code of the acknowledgment, only meaningful if bWasDelivered
+	 */
+	int32 StatusCode = 0;
+
+	/**
+	 * @brief Value of the Retry-After header, empty if there was none
+	 */
+	FString RetryAfter;
+};
+
+/**
+ * @brief Called once per sent batch with its acknowledgment
+ * @note Transports complete on the game thread, or on any thread when created with bCompleteOnAnyThread
+ */
+DECLARE_DELEGATE_OneParam(FOnAptabaseTransportComplete, const FAptabaseTransportResponse& /* Response */);
+
+/**
+ * @brief Batch handed over to a transport and not acknowledged yet
+ */
+class IAptabaseTransportRequest
+{
+public:
+	virtual ~IAptabaseTransportRequest() = default;
+	/**
+	 * @brief Starts delivering the body. The completion may run before this returns, e.g. when the request fails up front.
+	 */
+	virtual void Process() = 0;
+	/**
+	 * @brief Gives up on the request. The completion may still be called, with bWasDelivered unset.
+	 */
+	virtual void Cancel() = 0;
+	/**
+	 * @brief Body as it was sent, the request took it over from the batch
+	 */
+	virtual const TArray<uint8>& GetBody() const = 0;
+	/**
+	 * @brief Whether the body was sent gzip compressed
+	 */
+	virtual bool IsCompressed() const = 0;
+};
+
+/**
+ * @brief Delivers encoded batches somewhere and reports their acknowledgments, chosen with the Transport setting
+ * @note Requests are only created and processed from the pipeline thread
+ */
+class IAptabaseTransport
+{
+public:
+	virtual ~IAptabaseTransport() = default;
+	/**
+	 * @brief Creates the transport selected in the settings
+	 * @param bCompleteOnAnyThread Whether completions may run on whatever thread is handling them instead of the game thread
+	 */
+	static TUniquePtr<IAptabaseTransport> Create(bool bCompleteOnAnyThread);
+	/**
+	 * @brief Prepares the delivery of a batch body, which only starts once the request is processed
+	 * @param Body JSON array of events, gzip compressed if bCompressed
+	 * @param OnComplete Called exactly once after Process unless the request is cancelled
+	 * @note Keeping creation apart from Process lets the caller track the request before its completion can run
+	 */
+	virtual TSharedRef<IAptabaseTransportRequest> CreateRequest(TArray<uint8>&& Body, bool bCompressed, FOnAptabaseTransportComplete&& OnComplete) = 0;
+	/**
+	 * @brief Whether compressed bodies are accepted, otherwise batches are always sent as plain JSON
+	 */
+	virtual bool SupportsCompression() const { return true; }
+	/**
+	 * @brief Processes completions while the core ticker can't, e.g. during a drain blocking the game thread
+	 * @note Game thread only
+	 */
+	virtual void Tick(float DeltaTime) = 0;
+};
+
+/**
+ * @brief Base for transports that don't go over the network, completing their requests from a core ticker after a delay
+ * @note The ticker is only registered while completions are pending
+ */
+class FAptabaseLocalTransport : public IAptabaseTransport
+{
+public:
+	virtual ~FAptabaseLocalTransport() override;
+	// Begin IAptabaseTransport Interface
+	virtual TSharedRef<IAptabaseTransportRequest> CreateRequest(TArray<uint8>&& Body, bool bCompressed, FOnAptabaseTransportComplete&& OnComplete) override;
+	virtual void Tick(float DeltaTime) override;
+	// End IAptabaseTransport Interface
+
+protected:
+	/**
+	 * @brief Delivers a body once its request is processed, on the pipeline thread
+	 * @param OutResponse Acknowledgment passed to the completion
+	 * @return Seconds until the completion is due
+	 */
+	virtual double Deliver(const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& OutResponse) = 0;
+	/**
+	 * @brief Whether completions run from inside Process instead of on a later tick, like an HTTP request failing before it is sent
+	 */
+	bool bCompleteInline = false;
+
+private:
+	/**
+	 * @brief Request held in memory until its completion is due
+	 */
+	class FRequest final : public IAptabaseTransportRequest, public TSharedFromThis<FRequest>
+	{
+	public:
+		FRequest(FAptabaseLocalTransport& InTransport, TArray<uint8>&& InBody, bool bInCompressed, FOnAptabaseTransportComplete&& InOnComplete)
+			: Transport(InTransport)
+			, Body(MoveTemp(InBody))
+			, bCompressed(bInCompressed)
+			, OnComplete(MoveTemp(InOnComplete))
+		{
+		}
+		// Begin IAptabaseTransportRequest Interface
+		virtual void Process() override { Transport.ProcessRequest(AsShared()); }
+		virtual void Cancel() override { bCancelled = true; }
+		virtual const TArray<uint8>& GetBody() const override { return Body; }
+		virtual bool IsCompressed() const override { return bCompressed; }
+		// End IAptabaseTransportRequest Interface
+
+		FAptabaseLocalTransport& Transport;
+		TArray<uint8> Body;
+		bool bCompressed = false;
+		FOnAptabaseTransportComplete OnComplete;
+		std::atomic<bool> bCancelled = false;
+	};
+	/**
+	 * @brief Completion waiting for its time
+	 */
+	struct FPendingCompletion
+	{
+		TSharedRef<FRequest> Request;
+		FAptabaseTransportResponse Response;
+		double DueTime = 0.0;
+	};
+	/**
+	 * @brief Delivers the body and completes the request inline or queues its completion
+	 */
+	void ProcessRequest(const TSharedRef<FRequest>& Request);
+	/**
+	 * @brief Calls the completion of a request that wasn't cancelled, once
+	 */
+	static void CompleteRequest(FRequest& Request, const FAptabaseTransportResponse& Response);
+	/**
+	 * @brief Runs the completions that are due, callable from the core ticker
+	 * @return Whether completions are still pending, the ticker is removed otherwise
+	 */
+	bool OnTick(float DeltaTime);
+	/**
+	 * @brief Completions not due yet, in the order they were added
+	 */
+	TArray<FPendingCompletion> PendingCompletions;
+	/**
+	 * @brief Guards PendingCompletions and TickerHandle, filled by the pipeline thread and emptied by the game thread
+	 */
+	FCriticalSection PendingCompletionsLock;
+	/**
+	 * @brief Ticker calling OnTick while completions are pending, reset once there are none
+	 */
+	FTSTicker::FDelegateHandle TickerHandle;
+};
@@ -0,0 +1,87 @@
+#include "AptabaseWorker.h"
+
+#include <HAL/Event.h>
+#include <HAL/PlatformProcess.h>
+#include <HAL/PlatformTLS.h>
+#include <HAL/RunnableThread.h>
+
+#include "AptabaseTrace.h"
+
+FAptabaseWorker::FAptabaseWorker()
+	: WakeUpEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+	Thread.Reset(FRunnableThread::Create(this, TEXT("AptabaseWorker"), 0, TPri_BelowNormal));
+}
+
+FAptabaseWorker::~FAptabaseWorker()
+{
+	if (Thread.IsValid())
+	{
+		Thread->Kill(true);
+		Thread.Reset();
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeUpEvent);
+}
+
+void FAptabaseWorker::Enqueue(TUniqueFunction<void()>&& Task)
+{
+	Tasks.Enqueue(MoveTemp(Task));
+	WakeUpEvent->Trigger();
+}
+
+void FAptabaseWorker::EnqueueAndWait(TUniqueFunction<void()>&& Task)
+{
+	if (IsInWorkerThread())
+	{
+		Task();
+		return;
+	}
+
+	FEvent* TaskDoneEvent = FPlatformProcess::GetSynchEventFromPool(true);
+	Enqueue([&Task, TaskDoneEvent]()
+	{
+		Task();
+		TaskDoneEvent->Trigger();
+	});
+
+	TaskDoneEvent->Wait();
+	FPlatformProcess::ReturnSynchEventToPool(TaskDoneEvent);
+}
+
+bool FAptabaseWorker::IsInWorkerThread() const
+{
+	return FPlatformTLS::GetCurrentThreadId() == ThreadId;
+}
+
+uint32 FAptabaseWorker::Run()
+{
+	LLM_SCOPE_BYTAG(Aptabase);
+
+	ThreadId = FPlatformTLS::GetCurrentThreadId();
+
+	while (!bStopRequested)
+	{
+		RunQueuedTasks();
+		WakeUpEvent->Wait();
+	}
+
+	// Whatever was queued before stopping still runs, e.g. the final flush of a session
+	RunQueuedTasks();
+	return 0;
+}
+
+void FAptabaseWorker::Stop()
+{
+	bStopRequested = true;
+	WakeUpEvent->Trigger();
+}
+
+void FAptabaseWorker::RunQueuedTasks()
+{
+	TUniqueFunction<void()> Task;
+	while (Tasks.Dequeue(Task))
+	{
+		Task();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Containers/Queue.h>
+#include <HAL/Runnable.h>
+#include <Templates/Function.h>
+#include <Templates/UniquePtr.h>
+
+#include <atomic>
+
+class FEvent;
+class FRunnableThread;
+
+/**
+ * @brief Low-priority thread running the tasks it is given, one after the other and in order
+ */
+class FAptabaseWorker final : public FRunnable
+{
+public:
+	FAptabaseWorker();
+	/**
+	 * @brief Runs the tasks that are still queued and joins the thread
+	 */
+	virtual ~FAptabaseWorker() override;
+	/**
+	 * @brief Queues a task, callable from any thread
+	 */
+	void Enqueue(TUniqueFunction<void()>&& Task);
+	/**
+	 * @brief Runs the task on the worker and blocks until it is done
+	 * @note Runs the task right away when called from the worker itself
+	 */
+	void EnqueueAndWait(TUniqueFunction<void()>&& Task);
+	/**
+	 * @brief Whether the caller is running on the worker thread
+	 */
+	bool IsInWorkerThread() const;
+
+private:
+	// Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End FRunnable Interface
+	/**
+	 * @brief Runs every task queued so far
+	 */
+	void RunQueuedTasks();
+	/**
+	 * @brief Tasks waiting to run
+	 */
+	TQueue<TUniqueFunction<void()>, EQueueMode::Mpsc> Tasks;
+	/**
+	 * @brief Signaled whenever a task is queued or the worker is asked to stop
+	 */
+	FEvent* WakeUpEvent = nullptr;
+	/**
+	 * @brief Set once the worker should exit after running the remaining tasks
+	 */
+	std::atomic<bool> bStopRequested = false;
+	/**
+	 * @brief Id of the worker thread, set as soon as it starts running
+	 */
+	std::atomic<uint32> ThreadId = 0;
+	/**
+	 * @brief The worker thread
+	 */
+	TUniquePtr<FRunnableThread> Thread;
+};
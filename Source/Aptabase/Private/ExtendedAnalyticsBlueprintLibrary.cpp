@@ -2,11 +2,18 @@
 
 #include <Analytics.h>
 #include <Interfaces/IAnalyticsProvider.h>
+#include <Modules/ModuleManager.h>
 
-#include "AptabaseAnalyticsProvider.h"
+#include "Aptabase.h"
 #include "AptabaseLog.h"
 #include "ExtendedAnalyticsEventAttribute.h"
 
+namespace
+{
+	// Set by GetAptabaseProvider once the default provider was validated, weak so it doesn't keep a destroyed provider around
+	TWeakPtr<IAptabaseAnalytics> CachedProvider;
+} // namespace
+
 FExtendedAnalyticsEventAttribute UExtendedAnalyticsBlueprintLibrary::MakeExtendedAnalyticsEventStringAttribute(const FString& Name, const FString& Value)
 {
 	FExtendedAnalyticsEventAttribute Attribute;
@@ -15,29 +22,88 @@ FExtendedAnalyticsEventAttribute UExtendedAnalyticsBlueprintLibrary::MakeExtende
 	return Attribute;
 }
 
-FExtendedAnalyticsEventAttribute UExtendedAnalyticsBlueprintLibrary::MakeExtendedAnalyticsEventNumberAttribute(const FString& Name, const float Value)
+FExtendedAnalyticsEventAttribute UExtendedAnalyticsBlueprintLibrary::MakeExtendedAnalyticsEventNumberAttribute(const FString& Name, const double Value)
 {
 	FExtendedAnalyticsEventAttribute Attribute;
 	Attribute.Key = Name;
-	Attribute.Value.Set<float>(Value);
+	Attribute.Value.Set<double>(Value);
 	return Attribute;
 }
 
-void UExtendedAnalyticsBlueprintLibrary::RecordEventWithAttributes(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes)
+FExtendedAnalyticsEventAttribute UExtendedAnalyticsBlueprintLibrary::MakeExtendedAnalyticsEventIntegerAttribute(const FString& Name, const int64 Value)
 {
-	const TSharedPtr<IAnalyticsProvider> Provider = FAnalytics::Get().GetDefaultConfiguredProvider();
-	if (!Provider.IsValid())
+	FExtendedAnalyticsEventAttribute Attribute;
+	Attribute.Key = Name;
+	Attribute.Value.Set<int64>(Value);
+	return Attribute;
+}
+
+FExtendedAnalyticsEventAttribute UExtendedAnalyticsBlueprintLibrary::MakeExtendedAnalyticsEventBoolAttribute(const FString& Name, const bool Value)
+{
+	FExtendedAnalyticsEventAttribute Attribute;
+	Attribute.Key = Name;
+	Attribute.Value.Set<bool>(Value);
+	return Attribute;
+}
+
+void UExtendedAnalyticsBlueprintLibrary::RecordEventWithAttributes(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority)
+{
+	const TSharedPtr<IAptabaseAnalytics> AptabaseProvider = GetAptabaseProvider();
+	if (!AptabaseProvider.IsValid())
 	{
-		UE_LOG(LogAptabase, Warning, TEXT("RecordEventWithAttributes: Failed to get the default analytics provider. Double check your [Analytics] configuration in your INI"));
+		UE_LOG(LogAptabase, Warning, TEXT("RecordEventWithAttributes: Attributes of type FExtendedAnalyticsEventAttribute only works with Aptabase analytics"));
 		return;
 	}
 
-	const TSharedPtr<FAptabaseAnalyticsProvider> AptabaseProvider = StaticCastSharedPtr<FAptabaseAnalyticsProvider>(Provider);
+	AptabaseProvider->RecordExtendedEvent(EventName, Attributes, Priority);
+}
+
+void UExtendedAnalyticsBlueprintLibrary::RecordEventsWithAttributes(const TArray<FExtendedAnalyticsEvent>& Events)
+{
+	const TSharedPtr<IAptabaseAnalytics> AptabaseProvider = GetAptabaseProvider();
 	if (!AptabaseProvider.IsValid())
 	{
-		UE_LOG(LogAptabase, Warning, TEXT("RecordEventWithAttributes: Attributes of type FExtendedAnalyticsEventAttribute only works with Aptabase analytics"));
+		UE_LOG(LogAptabase, Warning, TEXT("RecordEventsWithAttributes: Attributes of type FExtendedAnalyticsEventAttribute only works with Aptabase analytics"));
 		return;
 	}
 
-	AptabaseProvider->RecordExtendedEvent(EventName, Attributes);
+	AptabaseProvider->RecordExtendedEvents(Events);
+}
+
+FAptabaseStats UExtendedAnalyticsBlueprintLibrary::GetAptabaseStats()
+{
+	const TSharedPtr<IAptabaseAnalytics> AptabaseProvider = GetAptabaseProvider();
+	if (!AptabaseProvider.IsValid())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("GetAptabaseStats: Stats are only available with Aptabase analytics"));
+		return FAptabaseStats();
+	}
+
+	return AptabaseProvider->GetStats();
+}
+
+TSharedPtr<IAptabaseAnalytics> UExtendedAnalyticsBlueprintLibrary::GetAptabaseProvider()
+{
+	if (const TSharedPtr<IAptabaseAnalytics> Cached = CachedProvider.Pin())
+	{
+		return Cached;
+	}
+
+	const TSharedPtr<IAnalyticsProvider> Provider = FAnalytics::Get().GetDefaultConfiguredProvider();
+	if (!Provider.IsValid())
+	{
+		UE_LOG(LogAptabase, Warning, TEXT("GetAptabaseProvider: Failed to get the default analytics provider. Double check your [Analytics] configuration in your INI"));
+		return nullptr;
+	}
+
+	// Any provider could be configured as the default one, only the instance created by this module is safe to cast
+	const FAptabaseModule* AptabaseModule = FModuleManager::GetModulePtr<FAptabaseModule>(TEXT("Aptabase"));
+	if (!AptabaseModule || AptabaseModule->AnalyticsProvider != Provider)
+	{
+		return nullptr;
+	}
+
+	const TSharedPtr<IAptabaseAnalytics> AptabaseProvider = StaticCastSharedPtr<IAptabaseAnalytics>(Provider);
+	CachedProvider = AptabaseProvider;
+	return AptabaseProvider;
 }
\ No newline at end of file
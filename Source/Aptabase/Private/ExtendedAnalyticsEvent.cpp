@@ -0,0 +1 @@
+#include "ExtendedAnalyticsEvent.h"
\ No newline at end of file
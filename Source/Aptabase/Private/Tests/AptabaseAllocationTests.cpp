@@ -0,0 +1,130 @@
+#include <Misc/AutomationTest.h>
+#include <Templates/UnrealTemplate.h>
+
+#include "AptabaseAllocationCounter.h"
+#include "AptabaseAnalyticsProvider.h"
+#include "AptabaseSettings.h"
+#include "ExtendedAnalyticsEventAttribute.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && !UE_BUILD_SHIPPING
+
+namespace
+{
+	// String values, so any copy of the attributes shows up as one allocation per attribute
+	constexpr int32 NumAllocationTestAttributes = 4;
+
+	// The ingest queue node, plus the attribute blocks shared by many events
+	constexpr double MaxAllocationsPerRecordedEvent = 1.5;
+
+	// Batch, body and request, shared by up to 25 events, plus the buffer growth shared by the whole flush
+	constexpr double MaxAllocationsPerFlushedEvent = 1.0;
+
+	// Loopback completions are due right away, this only bounds a test that went wrong
+	constexpr double AllocationTestTimeout = 5.0;
+
+	/**
+	 * @brief Instant loopback delivery on the game thread, with nothing persisted, compressed or sliced
+	 */
+	struct FScopedAllocationTestSettings
+	{
+		UAptabaseSettings* Settings = GetMutableDefault<UAptabaseSettings>();
+		TGuardValue<EAptabaseTransport> Transport{Settings->Transport, EAptabaseTransport::Loopback};
+		TGuardValue<float> LoopbackLatency{Settings->LoopbackLatency, 0.0f};
+		TGuardValue<float> LoopbackFailureRate{Settings->LoopbackFailureRate, 0.0f};
+		TGuardValue<float> LoopbackErrorRate{Settings->LoopbackErrorRate, 0.0f};
+		TGuardValue<bool> bCompressRequests{Settings->bCompressRequests, false};
+		TGuardValue<bool> bPersistEvents{Settings->bPersistEvents, false};
+		TGuardValue<bool> bUseBackgroundWorker{Settings->bUseBackgroundWorker, false};
+		TGuardValue<float> FlushTimeBudgetMs{Settings->FlushTimeBudgetMs, 0.0f};
+		TGuardValue<int32> MaxConcurrentRequests{Settings->MaxConcurrentRequests, MAX_int32};
+		TGuardValue<int32> MaxQueuedEvents{Settings->MaxQueuedEvents, MAX_int32};
+		TGuardValue<int32> MaxQueuedBytes{Settings->MaxQueuedBytes, MAX_int32};
+	};
+
+	/**
+	 * @brief Allocations per event made by the thread recording and flushing
+	 */
+	struct FAllocationsPerEvent
+	{
+		double Record = 0.0;
+		double Flush = 0.0;
+		int32 NumAttributesLeft = 0;
+	};
+
+	FAllocationsPerEvent CountPipelineAllocations(IAptabaseAnalytics& Provider, int32 NumEvents)
+	{
+		// Built outside of the counted scope, their strings are moved into the events
+		TArray<TArray<FExtendedAnalyticsEventAttribute>> AttributesPerEvent;
+		for (int32 EventIndex = 0; EventIndex < NumEvents; ++EventIndex)
+		{
+			TArray<FExtendedAnalyticsEventAttribute>& Attributes = AttributesPerEvent.AddDefaulted_GetRef();
+			for (int32 AttributeIndex = 0; AttributeIndex < NumAllocationTestAttributes; ++AttributeIndex)
+			{
+				FExtendedAnalyticsEventAttribute& Attribute = Attributes.AddDefaulted_GetRef();
+				Attribute.Key = FString::Printf(TEXT("attribute_%d"), AttributeIndex);
+				Attribute.Value.Set<FString>(FString::Printf(TEXT("a value long enough to need its own allocation %d"), EventIndex));
+			}
+		}
+
+		const FString EventName = TEXT("allocation_test");
+		FAllocationsPerEvent Result;
+		{
+			FAptabaseAllocationCounter AllocationCounter;
+			for (TArray<FExtendedAnalyticsEventAttribute>& Attributes : AttributesPerEvent)
+			{
+				Provider.RecordExtendedEvent(EventName, MoveTemp(Attributes));
+			}
+			Result.Record = static_cast<double>(AllocationCounter.GetNumAllocations()) / NumEvents;
+		}
+		{
+			FAptabaseAllocationCounter AllocationCounter;
+			Provider.FlushEvents();
+			Result.Flush = static_cast<double>(AllocationCounter.GetNumAllocations()) / NumEvents;
+		}
+		Provider.Drain(AllocationTestTimeout);
+
+		for (const TArray<FExtendedAnalyticsEventAttribute>& Attributes : AttributesPerEvent)
+		{
+			Result.NumAttributesLeft += Attributes.Num();
+		}
+
+		return Result;
+	}
+} // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAptabaseAllocationsPerEventTest, "Aptabase.Pipeline.AllocationsPerEvent", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAptabaseAllocationsPerEventTest::RunTest(const FString& Parameters)
+{
+	const FScopedAllocationTestSettings TestSettings;
+
+	const TSharedRef<IAptabaseAnalytics> Provider = MakeShared<FAptabaseAnalyticsProvider>();
+	Provider->StartSession(TArray<FAnalyticsEventAttribute>());
+
+	// Warm-up, interns the names and grows the containers that persist between flushes
+	CountPipelineAllocations(*Provider, 2500);
+
+	const int64 EventsSentBefore = Provider->GetStats().EventsSent;
+	const FAllocationsPerEvent Small = CountPipelineAllocations(*Provider, 250);
+	const FAllocationsPerEvent Large = CountPipelineAllocations(*Provider, 2500);
+	TestEqual(TEXT("Events sent"), Provider->GetStats().EventsSent - EventsSentBefore, static_cast<int64>(250 + 2500));
+
+	// A copy of the attributes would cost at least one allocation per attribute, well over these budgets
+	const auto TestRun = [this](int32 NumEvents, const FAllocationsPerEvent& Run)
+	{
+		TestEqual(FString::Printf(TEXT("Attributes left behind by the rvalue overload (%d events)"), NumEvents), Run.NumAttributesLeft, 0);
+		TestTrue(FString::Printf(TEXT("Recording allocates %.2f times per event (%d events), at most %.1f"), Run.Record, NumEvents, MaxAllocationsPerRecordedEvent), Run.Record <= MaxAllocationsPerRecordedEvent);
+		TestTrue(FString::Printf(TEXT("Flushing allocates %.2f times per event (%d events), at most %.1f"), Run.Flush, NumEvents, MaxAllocationsPerFlushedEvent), Run.Flush <= MaxAllocationsPerFlushedEvent);
+	};
+	TestRun(250, Small);
+	TestRun(2500, Large);
+
+	// A fixed number per event: ten times the events cost ten times the allocations, give or take the amortized growth
+	TestNearlyEqual(TEXT("Allocations per recorded event don't depend on the number of events"), Large.Record, Small.Record, 0.5);
+	TestNearlyEqual(TEXT("Allocations per flushed event don't depend on the number of events"), Large.Flush, Small.Flush, 0.5);
+
+	Provider->EndSession();
+	return true;
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include <Misc/AutomationTest.h>
+#include <Policies/CondensedJsonPrintPolicy.h>
+#include <Serialization/JsonSerializer.h>
+#include <Serialization/JsonWriter.h>
+
+#include "AptabaseData.h"
+#include "AptabaseEventBuffer.h"
+#include "AptabaseEventSerializer.h"
+#include "AptabaseNameTable.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	TSharedRef<FAptabaseSessionSnapshot> MakeSerializerTestSession(const FString& SessionId, const FString& Locale)
+	{
+		const TSharedRef<FAptabaseSessionSnapshot> Session = MakeShared<FAptabaseSessionSnapshot>();
+		Session->SessionId = SessionId;
+		Session->SystemProps.IsDebug = true;
+		Session->SystemProps.Locale = Locale;
+		Session->SystemProps.AppVersion = TEXT("1.2.3 \"beta\"");
+		Session->SystemProps.SdkVersion = TEXT("aptabase-unreal@test");
+		Session->SystemProps.OsName = TEXT("Windows\\Linux");
+		Session->SystemProps.OsVersion = FString(UTF8_TO_TCHAR("10 \xE2\x80\x93 22H2"));
+		return Session;
+	}
+
+	FAptabaseEventPayload& AddSerializerTestEvent(TArray<FAptabaseEventPayload>& Events, const TSharedRef<FAptabaseSessionSnapshot>& Session, const FString& EventName)
+	{
+		FAptabaseEventPayload& Event = Events.AddDefaulted_GetRef();
+		Event.TimeStamp = FDateTime(2024, 2, 29, 23, 59, 58, 7 * Events.Num());
+		Event.EventName = FAptabaseNameTable::Get().Intern(EventName);
+		Event.Session = Session;
+		return Event;
+	}
+
+	template <typename ValueType>
+	void AddSerializerTestAttribute(FAptabaseEventPayload& Event, const FString& Key, ValueType Value)
+	{
+		FAptabaseEventAttribute& Attribute = Event.EventAttributes.AddDefaulted_GetRef();
+		Attribute.Key = FAptabaseNameTable::Get().Intern(Key);
+		Attribute.Value.Set<ValueType>(Value);
+	}
+
+	TArray<FAptabaseEventPayload> MakeSerializerTestEvents()
+	{
+		const TSharedRef<FAptabaseSessionSnapshot> Session = MakeSerializerTestSession(TEXT("172800000012345678"), TEXT("en-US"));
+		const TSharedRef<FAptabaseSessionSnapshot> OtherSession = MakeSerializerTestSession(TEXT("172800000087654321"), FString(UTF8_TO_TCHAR("fr-CA \xC3\xA9t\xC3\xA9")));
+
+		TArray<FAptabaseEventPayload> Events;
+
+		// No attributes at all
+		AddSerializerTestEvent(Events, Session, TEXT("app_started"));
+
+		// Everything JSON escapes, in the event name, keys and values
+		FAptabaseEventPayload& EscapedEvent = AddSerializerTestEvent(Events, Session, TEXT("quote\" backslash\\ slash/"));
+		AddSerializerTestAttribute<FString>(EscapedEvent, TEXT("escapes"), TEXT("\" \\ / \b \f \n \r \t"));
+		AddSerializerTestAttribute<FString>(EscapedEvent, TEXT("control"), FString::Printf(TEXT("%c%c%c%c"), TCHAR(0x01), TCHAR(0x1F), TCHAR(0x7F), TCHAR(0x0B)));
+		AddSerializerTestAttribute<FString>(EscapedEvent, TEXT("key \"with\"\nescapes"), TEXT(""));
+
+		// Non-ASCII text: two and three byte UTF-8 sequences and a character outside of the BMP
+		FAptabaseEventPayload& UnicodeEvent = AddSerializerTestEvent(Events, OtherSession, FString(UTF8_TO_TCHAR("\xC3\xA9v\xC3\xA9nement")));
+		AddSerializerTestAttribute<FString>(UnicodeEvent, TEXT("latin"), FString(UTF8_TO_TCHAR("caf\xC3\xA9 na\xC3\xAFve")));
+		AddSerializerTestAttribute<FString>(UnicodeEvent, TEXT("cjk"), FString(UTF8_TO_TCHAR("\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E")));
+		AddSerializerTestAttribute<FString>(UnicodeEvent, TEXT("emoji"), FString(UTF8_TO_TCHAR("\xF0\x9F\x98\x80 \xF0\x9F\x8E\xAE")));
+		AddSerializerTestAttribute<FString>(UnicodeEvent, FString(UTF8_TO_TCHAR("cl\xC3\xA9")), TEXT("value"));
+
+		// int64 keeps every digit, past what a double holds
+		FAptabaseEventPayload& IntegerEvent = AddSerializerTestEvent(Events, Session, TEXT("integers"));
+		AddSerializerTestAttribute<int64>(IntegerEvent, TEXT("zero"), 0);
+		AddSerializerTestAttribute<int64>(IntegerEvent, TEXT("negative"), -1);
+		AddSerializerTestAttribute<int64>(IntegerEvent, TEXT("above_2_53"), 9007199254740993);
+		AddSerializerTestAttribute<int64>(IntegerEvent, TEXT("max"), MAX_int64);
+		AddSerializerTestAttribute<int64>(IntegerEvent, TEXT("min"), MIN_int64);
+
+		FAptabaseEventPayload& NumberEvent = AddSerializerTestEvent(Events, Session, TEXT("numbers"));
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("zero"), 0.0);
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("whole"), 42.0);
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("fraction"), -0.5);
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("third"), 1.0 / 3.0);
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("small"), 1e-7);
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("large"), 1e300);
+		AddSerializerTestAttribute<double>(NumberEvent, TEXT("long"), 123456789012345.678);
+		AddSerializerTestAttribute<float>(NumberEvent, TEXT("float"), 0.1f);
+		AddSerializerTestAttribute<bool>(NumberEvent, TEXT("true"), true);
+		AddSerializerTestAttribute<bool>(NumberEvent, TEXT("false"), false);
+
+		// FJsonObject keys are case-insensitive and the last value wins
+		FAptabaseEventPayload& DuplicateEvent = AddSerializerTestEvent(Events, OtherSession, TEXT("duplicates"));
+		AddSerializerTestAttribute<FString>(DuplicateEvent, TEXT("level"), TEXT("first"));
+		AddSerializerTestAttribute<int64>(DuplicateEvent, TEXT("score"), 1);
+		AddSerializerTestAttribute<bool>(DuplicateEvent, TEXT("Level"), true);
+		AddSerializerTestAttribute<double>(DuplicateEvent, TEXT("level"), 2.5);
+
+		// Back to the first session, its system properties must not be left over from the other one
+		FAptabaseEventPayload& MixedEvent = AddSerializerTestEvent(Events, Session, TEXT("mixed"));
+		AddSerializerTestAttribute<FString>(MixedEvent, TEXT("string"), TEXT("text"));
+		AddSerializerTestAttribute<int64>(MixedEvent, TEXT("int64"), 1234567890123);
+		AddSerializerTestAttribute<double>(MixedEvent, TEXT("double"), 99.99);
+		AddSerializerTestAttribute<bool>(MixedEvent, TEXT("bool"), true);
+
+		return Events;
+	}
+
+	FString SerializeWithJsonObjects(TConstArrayView<FAptabaseEventPayload> Events)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		for (const FAptabaseEventPayload& Event : Events)
+		{
+			Values.Add(MakeShared<FJsonValueObject>(Event.ToJsonObject()));
+		}
+
+		FString Json;
+		const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+		FJsonSerializer::Serialize(Values, Writer);
+		return Json;
+	}
+
+	FString Utf8BytesToString(const TArray<uint8>& Bytes)
+	{
+		const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Bytes.GetData()), Bytes.Num());
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+	TArray<uint8> StringToUtf8Bytes(const FString& String)
+	{
+		const FTCHARToUTF8 Converted(*String);
+		return TArray<uint8>(reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+	}
+} // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAptabaseEventSerializerMatchesJsonObjectTest, "Aptabase.EventSerializer.MatchesJsonObject", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAptabaseEventSerializerMatchesJsonObjectTest::RunTest(const FString& Parameters)
+{
+	const TArray<FAptabaseEventPayload> Events = MakeSerializerTestEvents();
+	const FString Expected = SerializeWithJsonObjects(Events);
+	const TArray<uint8> ExpectedBytes = StringToUtf8Bytes(Expected);
+
+	// Each event on its own first, so a mismatch points at the case that caused it
+	FAptabaseEventSerializer Serializer;
+	for (int32 EventIndex = 0; EventIndex < Events.Num(); ++EventIndex)
+	{
+		const TConstArrayView<FAptabaseEventPayload> Event = MakeArrayView(&Events[EventIndex], 1);
+		const FString EventName = FAptabaseNameTable::Get().Resolve(Events[EventIndex].EventName).String;
+		TestEqual(FString::Printf(TEXT("Event %d (%s)"), EventIndex, *EventName), Utf8BytesToString(Serializer.SerializeBatch(Event)), SerializeWithJsonObjects(Event));
+	}
+
+	const TArray<uint8>& Batch = Serializer.SerializeBatch(Events);
+	TestEqual(TEXT("SerializeBatch"), Utf8BytesToString(Batch), Expected);
+	TestTrue(TEXT("SerializeBatch is byte-identical"), Batch == ExpectedBytes);
+
+	// The pipeline encodes from the event buffer one event at a time
+	FAptabaseEventBuffer Buffer;
+	for (FAptabaseEventPayload& Event : MakeSerializerTestEvents())
+	{
+		Buffer.Add(MoveTemp(Event));
+	}
+
+	Serializer.BeginBatch();
+	for (int32 EventIndex = 0; EventIndex < Buffer.Num(); ++EventIndex)
+	{
+		Serializer.WriteEvent(Buffer, EventIndex);
+	}
+	TestEqual(TEXT("Number of events written"), Serializer.GetNumEvents(), Events.Num());
+
+	const TArray<uint8>& BufferedBatch = Serializer.EndBatch();
+	TestEqual(TEXT("WriteEvent from the event buffer"), Utf8BytesToString(BufferedBatch), Expected);
+	TestTrue(TEXT("WriteEvent from the event buffer is byte-identical"), BufferedBatch == ExpectedBytes);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include <Misc/AutomationTest.h>
+#include <Misc/Compression.h>
+#include <Serialization/JsonReader.h>
+#include <Serialization/JsonSerializer.h>
+#include <Templates/UnrealTemplate.h>
+
+#include "AptabaseAnalyticsProvider.h"
+#include "AptabaseLoopbackTransport.h"
+#include "AptabaseSettings.h"
+#include "AptabaseTransport.h"
+#include "ExtendedAnalyticsEventAttribute.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// Every test batch fits in a single request
+	constexpr int32 NumLoopbackTestEvents = 10;
+
+	// Several batches, so later ones wait for the request slot of the first
+	constexpr int32 NumSynchronousTestEvents = 60;
+
+	// Loopback completions are due right away, this only bounds a test that went wrong
+	constexpr double LoopbackTestTimeout = 5.0;
+
+	/**
+	 * @brief Instant, lossless loopback delivery compressing every batch, for the providers created by a test
+	 */
+	struct FScopedLoopbackTestSettings
+	{
+		UAptabaseSettings* Settings = GetMutableDefault<UAptabaseSettings>();
+		TGuardValue<float> LoopbackLatency{Settings->LoopbackLatency, 0.0f};
+		TGuardValue<float> LoopbackFailureRate{Settings->LoopbackFailureRate, 0.0f};
+		TGuardValue<float> LoopbackErrorRate{Settings->LoopbackErrorRate, 0.0f};
+		TGuardValue<bool> bCompressRequests{Settings->bCompressRequests, true};
+		TGuardValue<int32> CompressionThreshold{Settings->CompressionThreshold, 0};
+		TGuardValue<bool> bPersistEvents{Settings->bPersistEvents, false};
+		TGuardValue<bool> bUseBackgroundWorker{Settings->bUseBackgroundWorker, false};
+		TGuardValue<float> FlushTimeBudgetMs{Settings->FlushTimeBudgetMs, 0.0f};
+	};
+
+	/**
+	 * @brief Body received by the loopback transport
+	 */
+	struct FLoopbackSentBody
+	{
+		TArray<uint8> Body;
+		bool bCompressed = false;
+	};
+
+	/**
+	 * @brief Creates a provider delivering through the given transport, with its session started
+	 */
+	TSharedRef<IAptabaseAnalytics> MakeLoopbackTestProvider(TUniquePtr<FAptabaseLoopbackTransport>&& Transport)
+	{
+		const TSharedRef<IAptabaseAnalytics> Provider = MakeShared<FAptabaseAnalyticsProvider>(MoveTemp(Transport));
+		Provider->StartSession(TArray<FAnalyticsEventAttribute>());
+		return Provider;
+	}
+
+	void RecordAndDeliverLoopbackTestEvents(IAptabaseAnalytics& Provider)
+	{
+		TArray<FExtendedAnalyticsEventAttribute> Attributes;
+		FExtendedAnalyticsEventAttribute& TextAttribute = Attributes.AddDefaulted_GetRef();
+		TextAttribute.Key = TEXT("text");
+		TextAttribute.Value.Set<FString>(FString(UTF8_TO_TCHAR("caf\xC3\xA9 \"quoted\"")));
+		FExtendedAnalyticsEventAttribute& IntegerAttribute = Attributes.AddDefaulted_GetRef();
+		IntegerAttribute.Key = TEXT("integer");
+		IntegerAttribute.Value.Set<int64>(9007199254740993);
+
+		for (int32 EventIndex = 0; EventIndex < NumLoopbackTestEvents; ++EventIndex)
+		{
+			Provider.RecordExtendedEvent(TEXT("loopback_test"), Attributes);
+		}
+
+		Provider.FlushEvents();
+		Provider.Drain(LoopbackTestTimeout);
+	}
+
+	bool DecompressGzip(const TArray<uint8>& Compressed, TArray<uint8>& OutUncompressed)
+	{
+		// Smallest gzip stream: 10 bytes of header and 8 of trailer
+		if (Compressed.Num() < 18 || Compressed[0] != 0x1F || Compressed[1] != 0x8B)
+		{
+			return false;
+		}
+
+		// The trailer ends with the uncompressed size, little-endian
+		const int32 Num = Compressed.Num();
+		const int32 UncompressedSize = Compressed[Num - 4] | Compressed[Num - 3] << 8 | Compressed[Num - 2] << 16 | Compressed[Num - 1] << 24;
+		OutUncompressed.SetNumUninitialized(UncompressedSize);
+		return FCompression::UncompressMemory(NAME_Gzip, OutUncompressed.GetData(), UncompressedSize, Compressed.GetData(), Compressed.Num());
+	}
+} // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAptabaseLoopbackCompressedBodyTest, "Aptabase.LoopbackTransport.CompressedBody", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAptabaseLoopbackCompressedBodyTest::RunTest(const FString& Parameters)
+{
+	const FScopedLoopbackTestSettings TestSettings;
+
+	TArray<FLoopbackSentBody> SentBodies;
+	TUniquePtr<FAptabaseLoopbackTransport> Transport = MakeUnique<FAptabaseLoopbackTransport>();
+	Transport->OnSend().BindLambda([&SentBodies](const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& InOutResponse)
+	{
+		SentBodies.Add({Body, bCompressed});
+	});
+
+	const TSharedRef<IAptabaseAnalytics> Provider = MakeLoopbackTestProvider(MoveTemp(Transport));
+	RecordAndDeliverLoopbackTestEvents(*Provider);
+
+	if (!TestEqual(TEXT("Requests sent"), SentBodies.Num(), 1))
+	{
+		return false;
+	}
+
+	const FLoopbackSentBody& Sent = SentBodies[0];
+	TestTrue(TEXT("Body is flagged as compressed"), Sent.bCompressed);
+
+	TArray<uint8> Uncompressed;
+	if (!TestTrue(TEXT("Body is a gzip stream"), DecompressGzip(Sent.Body, Uncompressed)))
+	{
+		return false;
+	}
+
+	const FAptabaseStats Stats = Provider->GetStats();
+	TestEqual(TEXT("Events sent"), Stats.EventsSent, static_cast<int64>(NumLoopbackTestEvents));
+	TestEqual(TEXT("Uncompressed size matches the encoded batch"), static_cast<int64>(Uncompressed.Num()), Stats.BytesBeforeCompression);
+	TestEqual(TEXT("Uploaded size matches the compressed body"), static_cast<int64>(Sent.Body.Num()), Stats.BytesUploaded);
+
+	// The decompressed body is the JSON batch with every event and attribute intact
+	const FUTF8ToTCHAR Utf8Json(reinterpret_cast<const ANSICHAR*>(Uncompressed.GetData()), Uncompressed.Num());
+	const FString Json(Utf8Json.Length(), Utf8Json.Get());
+	TArray<TSharedPtr<FJsonValue>> Events;
+	if (!TestTrue(TEXT("Body is a JSON array"), FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Events)))
+	{
+		return false;
+	}
+
+	// Checked on the text, parsing would take the integer through a double
+	const FString FullInteger = TEXT("\"integer\":9007199254740993");
+	int32 NumFullIntegers = 0;
+	for (int32 Index = Json.Find(FullInteger); Index != INDEX_NONE; Index = Json.Find(FullInteger, ESearchCase::CaseSensitive, ESearchDir::FromStart, Index + 1))
+	{
+		++NumFullIntegers;
+	}
+	TestEqual(TEXT("int64 attributes with every digit"), NumFullIntegers, NumLoopbackTestEvents);
+
+	TestEqual(TEXT("Events in the body"), Events.Num(), NumLoopbackTestEvents);
+	for (const TSharedPtr<FJsonValue>& Event : Events)
+	{
+		const TSharedPtr<FJsonObject> EventObject = Event->AsObject();
+		TestEqual(TEXT("Event name"), EventObject->GetStringField(TEXT("eventName")), FString(TEXT("loopback_test")));
+
+		const TSharedPtr<FJsonObject> Props = EventObject->GetObjectField(TEXT("props"));
+		TestEqual(TEXT("String attribute"), Props->GetStringField(TEXT("text")), FString(UTF8_TO_TCHAR("caf\xC3\xA9 \"quoted\"")));
+		TestTrue(TEXT("int64 attribute"), Props->HasField(TEXT("integer")));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAptabaseLoopbackCompressionFallbackTest, "Aptabase.LoopbackTransport.CompressionFallback", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAptabaseLoopbackCompressionFallbackTest::RunTest(const FString& Parameters)
+{
+	const FScopedLoopbackTestSettings TestSettings;
+
+	for (const int32 RejectionStatusCode : {400, 415})
+	{
+		// Compressed bodies are answered with the rejection, plain JSON is accepted
+		TArray<FLoopbackSentBody> SentBodies;
+		TUniquePtr<FAptabaseLoopbackTransport> Transport = MakeUnique<FAptabaseLoopbackTransport>();
+		Transport->OnSend().BindLambda([&SentBodies, RejectionStatusCode](const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& InOutResponse)
+		{
+			SentBodies.Add({Body, bCompressed});
+			if (bCompressed)
+			{
+				InOutResponse.bWasDelivered = true;
+				InOutResponse.StatusCode = RejectionStatusCode;
+			}
+		});
+
+		const TSharedRef<IAptabaseAnalytics> Provider = MakeLoopbackTestProvider(MoveTemp(Transport));
+		RecordAndDeliverLoopbackTestEvents(*Provider);
+
+		// The rejected batch is sent again right away, uncompressed
+		if (!TestEqual(FString::Printf(TEXT("Requests sent after a %d"), RejectionStatusCode), SentBodies.Num(), 2))
+		{
+			continue;
+		}
+
+		TestTrue(FString::Printf(TEXT("First request is compressed (%d)"), RejectionStatusCode), SentBodies[0].bCompressed);
+		TestFalse(FString::Printf(TEXT("Request after a %d is uncompressed"), RejectionStatusCode), SentBodies[1].bCompressed);
+
+		TArray<uint8> Uncompressed;
+		TestTrue(FString::Printf(TEXT("Rejected body is a gzip stream (%d)"), RejectionStatusCode), DecompressGzip(SentBodies[0].Body, Uncompressed));
+		TestTrue(FString::Printf(TEXT("Uncompressed body after a %d is the rejected body decompressed"), RejectionStatusCode), Uncompressed == SentBodies[1].Body);
+
+		FAptabaseStats Stats = Provider->GetStats();
+		TestEqual(FString::Printf(TEXT("Events sent after a %d"), RejectionStatusCode), Stats.EventsSent, static_cast<int64>(NumLoopbackTestEvents));
+		TestEqual(FString::Printf(TEXT("Events discarded after a %d"), RejectionStatusCode), Stats.EventsDiscarded, static_cast<int64>(0));
+		TestEqual(FString::Printf(TEXT("Bytes before compression after a %d count the batch once"), RejectionStatusCode), Stats.BytesBeforeCompression, static_cast<int64>(SentBodies[1].Body.Num()));
+
+		// Compression stays off for the rest of the provider's lifetime
+		RecordAndDeliverLoopbackTestEvents(*Provider);
+		if (TestEqual(FString::Printf(TEXT("Requests sent for the next batch after a %d"), RejectionStatusCode), SentBodies.Num(), 3))
+		{
+			TestFalse(FString::Printf(TEXT("Next batch after a %d is uncompressed"), RejectionStatusCode), SentBodies[2].bCompressed);
+		}
+
+		Stats = Provider->GetStats();
+		TestEqual(FString::Printf(TEXT("Events sent in total after a %d"), RejectionStatusCode), Stats.EventsSent, static_cast<int64>(2 * NumLoopbackTestEvents));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAptabaseLoopbackSynchronousCompletionTest, "Aptabase.LoopbackTransport.SynchronousCompletion", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAptabaseLoopbackSynchronousCompletionTest::RunTest(const FString& Parameters)
+{
+	const FScopedLoopbackTestSettings TestSettings;
+
+	// A single slot: every batch after the first is only sent once the completion of the previous one freed it
+	const TGuardValue<int32> MaxConcurrentRequests(TestSettings.Settings->MaxConcurrentRequests, 1);
+
+	for (const bool bWasDelivered : {true, false})
+	{
+		int32 NumRequests = 0;
+		TUniquePtr<FAptabaseLoopbackTransport> Transport = MakeUnique<FAptabaseLoopbackTransport>();
+		Transport->SetCompleteInline(true);
+		Transport->OnSend().BindLambda([&NumRequests, bWasDelivered](const TArray<uint8>& Body, bool bCompressed, FAptabaseTransportResponse& InOutResponse)
+		{
+			++NumRequests;
+			InOutResponse.bWasDelivered = bWasDelivered;
+		});
+
+		const TSharedRef<IAptabaseAnalytics> Provider = MakeLoopbackTestProvider(MoveTemp(Transport));
+		for (int32 EventIndex = 0; EventIndex < NumSynchronousTestEvents; ++EventIndex)
+		{
+			Provider->RecordEvent(TEXT("synchronous_test"), TArray<FAnalyticsEventAttribute>());
+		}
+
+		// Everything completes from inside the flush, nothing is left for a drain
+		Provider->FlushEvents();
+
+		const TCHAR* Outcome = bWasDelivered ? TEXT("delivered") : TEXT("failed");
+		const FAptabaseStats Stats = Provider->GetStats();
+		TestTrue(FString::Printf(TEXT("Several requests sent (%s)"), Outcome), NumRequests > 1);
+		TestEqual(FString::Printf(TEXT("Requests in flight after the flush (%s)"), Outcome), Stats.RequestsInFlight, 0);
+		TestEqual(FString::Printf(TEXT("Events sent (%s)"), Outcome), Stats.EventsSent, static_cast<int64>(bWasDelivered ? NumSynchronousTestEvents : 0));
+		TestEqual(FString::Printf(TEXT("Events retried (%s)"), Outcome), Stats.EventsRetried, static_cast<int64>(bWasDelivered ? 0 : NumSynchronousTestEvents));
+
+		Provider->EndSession();
+	}
+
+	return true;
+}
+
+#endif
@@ -15,7 +15,7 @@ public:
 	// End IAnalyticsProviderModule Interface
 	/**
 	 * @brief Callback executed before the application is shutdown.
-	 * @note We will clean up the analytics provider and end the session if it's left running.
+	 * @note We will end the session if it's left running, wait up to ShutdownDrainTimeout for its last events to be sent and clean up the analytics provider.
 	 */
 	void OnApplicationShutdown();
 #if WITH_EDITOR
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Containers/ArrayView.h>
+#include <Delegates/Delegate.h>
+#include <Interfaces/IAnalyticsProvider.h>
+
+#include "AptabaseEventPriority.h"
+#include "AptabaseSession.h"
+#include "AptabaseStats.h"
+
+struct FExtendedAnalyticsEvent;
+struct FExtendedAnalyticsEventAttribute;
+
+/**
+ * @brief Called with the body and number of events of every batch still undelivered once a drain runs out of time
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnAptabaseUnsentBatch, const TArray<uint8>& /* Body */, int32 /* NumEvents */);
+
+/**
+ * @brief Aptabase features on top of IAnalyticsProvider: typed attributes, priorities, multiplexed sessions, stats and shutdown draining
+ * @note Implemented by the provider the Aptabase module creates, see UExtendedAnalyticsBlueprintLibrary::GetAptabaseProvider
+ */
+class APTABASE_API IAptabaseAnalytics : public IAnalyticsProvider
+{
+public:
+	using IAnalyticsProvider::EndSession;
+	using IAnalyticsProvider::GetSessionID;
+
+	/**
+	 * Overload for RecordEvent that takes an array of ExtendedAttributes
+	 * @param Priority Critical events are sent within CriticalSendInterval, Low events are the first ones dropped when the queue is full
+	 */
+	virtual void RecordExtendedEvent(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) = 0;
+	/**
+	 * Overload for RecordExtendedEvent that moves the attribute values into the event instead of copying them
+	 * @note The event name is interned, so it is only copied the first time it is recorded
+	 */
+	virtual void RecordExtendedEvent(const FString& EventName, TArray<FExtendedAnalyticsEventAttribute>&& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) = 0;
+	/**
+	 * @brief Records several events at once, checking the session and timing the call only once for all of them
+	 */
+	virtual void RecordExtendedEvents(TConstArrayView<FExtendedAnalyticsEvent> Events) = 0;
+	/**
+	 * @brief Starts another session next to the provider's own one, sharing its batching and requests
+	 * @param Properties System properties reported by the new session instead of the local ones, e.g. those of a remote player
+	 * @note Must be called from the game thread while the provider's session is active. Ends with the provider's session at the latest.
+	 * @return Handle to record events for the new session with, the default handle if there is no active session
+	 */
+	virtual FAptabaseSessionHandle CreateSession(const FAptabaseSessionProperties& Properties = FAptabaseSessionProperties()) = 0;
+	/**
+	 * @brief Ends a session started with CreateSession. Events already recorded for it are still sent.
+	 */
+	virtual void EndSession(FAptabaseSessionHandle Session) = 0;
+	/**
+	 * @brief Id of a session started with CreateSession, or of the provider's session for the default handle
+	 */
+	virtual FString GetSessionID(FAptabaseSessionHandle Session) const = 0;
+	/**
+	 * @brief RecordEvent for one of the sessions started with CreateSession
+	 * @note Callable from any thread
+	 */
+	virtual void RecordSessionEvent(FAptabaseSessionHandle Session, const FString& EventName, const TArray<FAnalyticsEventAttribute>& Attributes) = 0;
+	/**
+	 * @brief RecordExtendedEvent for one of the sessions started with CreateSession
+	 * @note Callable from any thread
+	 */
+	virtual void RecordSessionExtendedEvent(FAptabaseSessionHandle Session, const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) = 0;
+	/**
+	 * @brief Overload for RecordSessionExtendedEvent that moves the attribute values into the event instead of copying them
+	 */
+	virtual void RecordSessionExtendedEvent(FAptabaseSessionHandle Session, const FString& EventName, TArray<FExtendedAnalyticsEventAttribute>&& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal) = 0;
+	/**
+	 * @brief Current state of the event pipeline
+	 * @note Callable from any thread
+	 */
+	virtual FAptabaseStats GetStats() const = 0;
+	/**
+	 * @brief Blocks until the requests in flight and the batches waiting for a slot are delivered, or until Timeout seconds passed
+	 * @note Meant for shutdown, after EndSession. Ticks the transport when called from the game thread, since nothing else will.
+	 * Batches still undelivered at the deadline are given to OnUnsentBatch and stay in the spool if bPersistEvents is enabled.
+	 */
+	virtual void Drain(double Timeout) = 0;
+	/**
+	 * @brief Persistence hook for the batches a drain couldn't deliver
+	 * @note Broadcast on the pipeline thread while Drain blocks the caller
+	 */
+	virtual FOnAptabaseUnsentBatch& OnUnsentBatch() = 0;
+};
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include <UObject/ObjectMacros.h>
+
+#include "AptabaseEventPriority.generated.h"
+
+/**
+ * @brief Importance of an event, used to decide what to drop first when the event queue is full
+ */
+UENUM(BlueprintType)
+enum class EAptabaseEventPriority : uint8
+{
+	Low,
+	Normal,
+	High,
+	Critical
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Containers/UnrealString.h>
+
+/**
+ * @brief Identifies one of the sessions multiplexed on the provider, e.g. one per player on a dedicated server
+ * @note The default handle refers to the provider's own session, started with StartSession
+ */
+struct FAptabaseSessionHandle
+{
+	/**
+	 * @brief Key in the session table, 0 for the provider's own session
+	 */
+	uint32 Id = 0;
+
+	bool IsDefault() const { return Id == 0; }
+	bool operator==(const FAptabaseSessionHandle& Other) const { return Id == Other.Id; }
+	bool operator!=(const FAptabaseSessionHandle& Other) const { return Id != Other.Id; }
+};
+
+/**
+ * @brief System properties a session reports instead of the ones of the machine running the provider
+ * @note Meant for servers recording events on behalf of remote players. Empty fields keep the local value.
+ */
+struct FAptabaseSessionProperties
+{
+	/**
+	 * @brief Localization language code used by the player, e.g. "en-US"
+	 */
+	FString Locale;
+
+	/**
+	 * @brief Version of the project the player runs
+	 */
+	FString AppVersion;
+
+	/**
+	 * @brief Name of the player's operating system
+	 */
+	FString OsName;
+
+	/**
+	 * @brief Version of the player's operating system
+	 */
+	FString OsVersion;
+};
@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include <UObject/ObjectMacros.h>
+
+#include "AptabaseStats.generated.h"
+
+/**
+ * @brief Snapshot of the Aptabase analytics pipeline counters
+ * @note Totals are counted since the provider was created
+ */
+USTRUCT(BlueprintType)
+struct FAptabaseStats
+{
+	GENERATED_BODY()
+
+	/**
+	 * @brief Upper bound of each RequestLatencyHistogram bucket, in milliseconds. The last bucket holds everything slower.
+	 */
+	static constexpr double LatencyBucketUpperBounds[] = {50.0, 100.0, 250.0, 500.0, 1000.0, 2500.0, 5000.0, 10000.0};
+	static constexpr int32 NumLatencyBuckets = UE_ARRAY_COUNT(LatencyBucketUpperBounds) + 1;
+
+	/**
+	 * @brief Events waiting to be sent, including batches waiting for a free request slot or a retry
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 QueuedEvents = 0;
+
+	/**
+	 * @brief Memory taken by the queued events
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 QueuedBytes = 0;
+
+	/**
+	 * @brief Events accepted while a session was active
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsRecorded = 0;
+
+	/**
+	 * @brief Events acknowledged by the backend
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsSent = 0;
+
+	/**
+	 * @brief Events dropped because the queue was over its budget, or because the name table was full of other event names and attribute keys
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsDropped = 0;
+
+	/**
+	 * @brief Events rejected by the backend or discarded after running out of retries
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsDiscarded = 0;
+
+	/**
+	 * @brief Events scheduled for another attempt, counted once per retry
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsRetried = 0;
+
+	/**
+	 * @brief Events not recorded because their session was not sampled by a sampling rule
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsSampledOut = 0;
+
+	/**
+	 * @brief Events not recorded because they exceeded the rate limit of a sampling rule
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 EventsRateLimited = 0;
+
+	/**
+	 * @brief Request bodies sent, as they went over the wire on the first attempt of each batch
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 BytesUploaded = 0;
+
+	/**
+	 * @brief Request bodies sent, before compression. Retries and uncompressed resends aren't counted again.
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 BytesBeforeCompression = 0;
+
+	/**
+	 * @brief Requests sent and not completed yet
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int32 RequestsInFlight = 0;
+
+	/**
+	 * @brief Number of completed requests per latency bucket, see LatencyBucketUpperBounds
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	TArray<int64> RequestLatencyHistogram;
+
+	/**
+	 * @brief Time spent recording events, summed over every calling thread
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics", meta = (Unit = "ms"))
+	double RecordTimeMs = 0.0;
+
+	/**
+	 * @brief Time spent flushing events on the pipeline thread: the game thread, or the worker when bUseBackgroundWorker is enabled
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics", meta = (Unit = "ms"))
+	double FlushTimeMs = 0.0;
+
+	/**
+	 * @brief Time the most recent flush slice took
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics", meta = (Unit = "ms"))
+	double LastFlushTimeMs = 0.0;
+
+	/**
+	 * @brief Time the longest flush slice took, to compare against FlushTimeBudgetMs
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics", meta = (Unit = "ms"))
+	double MaxFlushTimeMs = 0.0;
+
+	/**
+	 * @brief Flush slices run so far, a flush over its time budget is spread over several of them
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Analytics")
+	int64 FlushSlices = 0;
+};
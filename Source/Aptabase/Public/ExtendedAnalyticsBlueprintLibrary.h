@@ -3,6 +3,9 @@
 #include <CoreMinimal.h>
 #include <Kismet/BlueprintFunctionLibrary.h>
 
+#include "AptabaseAnalytics.h"
+#include "AptabaseStats.h"
+#include "ExtendedAnalyticsEvent.h"
 #include "ExtendedAnalyticsEventAttribute.h"
 
 #include "ExtendedAnalyticsBlueprintLibrary.generated.h"
@@ -25,10 +28,36 @@ public:
 	 * Creates and ExtendedAnalyticsEventAttribute with a name and a number (double) value
 	 */
 	UFUNCTION(BlueprintPure, Category = "Analytics")
-	static FExtendedAnalyticsEventAttribute MakeExtendedAnalyticsEventNumberAttribute(const FString& Name, const float Value);
+	static FExtendedAnalyticsEventAttribute MakeExtendedAnalyticsEventNumberAttribute(const FString& Name, const double Value);
+	/**
+	 * Creates and ExtendedAnalyticsEventAttribute with a name and an integer (int64) value, sent without losing precision
+	 */
+	UFUNCTION(BlueprintPure, Category = "Analytics")
+	static FExtendedAnalyticsEventAttribute MakeExtendedAnalyticsEventIntegerAttribute(const FString& Name, const int64 Value);
+	/**
+	 * Creates and ExtendedAnalyticsEventAttribute with a name and a boolean value
+	 */
+	UFUNCTION(BlueprintPure, Category = "Analytics")
+	static FExtendedAnalyticsEventAttribute MakeExtendedAnalyticsEventBoolAttribute(const FString& Name, const bool Value);
 	/**
 	 * Records an event has happened by name with an array of ExtendedAttributes (preserve native type)
+	 * @param Priority Critical events are sent within CriticalSendInterval instead of waiting for the next flush
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Analytics", meta = (AdvancedDisplay = "Priority"))
+	static void RecordEventWithAttributes(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes, EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal);
+	/**
+	 * Records several events with their ExtendedAttributes in a single call (preserve native type)
 	 */
 	UFUNCTION(BlueprintCallable, Category = "Analytics")
-	static void RecordEventWithAttributes(const FString& EventName, const TArray<FExtendedAnalyticsEventAttribute>& Attributes);
+	static void RecordEventsWithAttributes(const TArray<FExtendedAnalyticsEvent>& Events);
+	/**
+	 * Returns the counters of the Aptabase analytics pipeline (queue depth, events sent and dropped, request latencies...)
+	 */
+	UFUNCTION(BlueprintPure, Category = "Analytics")
+	static FAptabaseStats GetAptabaseStats();
+	/**
+	 * Returns the Aptabase provider if it is the default configured one, null otherwise
+	 * @note The provider is looked up and validated once, later calls reuse it for as long as it is alive
+	 */
+	static TSharedPtr<IAptabaseAnalytics> GetAptabaseProvider();
 };
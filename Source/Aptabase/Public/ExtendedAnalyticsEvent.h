@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "AptabaseEventPriority.h"
+#include "ExtendedAnalyticsEventAttribute.h"
+
+#include "ExtendedAnalyticsEvent.generated.h"
+
+/**
+ * Struct to record several events with a single call
+ * @note see UExtendedAnalyticsBlueprintLibrary::RecordEventsWithAttributes
+ */
+USTRUCT(BlueprintType)
+struct FExtendedAnalyticsEvent
+{
+	GENERATED_BODY();
+
+	/**
+	 * Name of the Event
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Analytics")
+	FString EventName;
+
+	/**
+	 * Attributes of the Event, made with the MakeExtendedAnalyticsEvent...Attribute functions
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Analytics")
+	TArray<FExtendedAnalyticsEventAttribute> Attributes;
+
+	/**
+	 * Importance of the Event, Critical events are sent within CriticalSendInterval and are the last ones dropped when the queue is full
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Analytics")
+	EAptabaseEventPriority Priority = EAptabaseEventPriority::Normal;
+};
@@ -21,7 +21,7 @@ struct FExtendedAnalyticsEventAttribute
 
 	/**
 	 * Value of the Attribute
-	 * @note we can support more types but they need to be converted to the correct JSON type before sending
+	 * @note sent as a JSON string, number or boolean. int64 keeps its full precision.
 	 */
-	TVariant<FString, float, double> Value;
+	TVariant<FString, float, double, int64, bool> Value;
 };